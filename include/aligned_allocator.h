@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/**
+ * Allocator returning Alignment-byte aligned storage (C++17 aligned new).
+ * Used for embedding/vector matrices so rows can be loaded with aligned SIMD.
+ */
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+// 64-byte aligned float buffer (one cache line / one AVX-512 register)
+using AlignedFloatVector = std::vector<float, AlignedAllocator<float, 64>>;
@@ -6,11 +6,16 @@
 #include <fstream>
 #include <unordered_set>
 #include <unordered_map>
+#include <cstdint>
+#include <memory>
 #include "stage1_lexicon.h"
 #include "stage2_forward_index.h"
 #include "stage3_inverted_index.h"
 #include "stage4_ranking.h"
 
+class SemanticEngine;
+class Autocomplete;
+
 /**
  * Stage 9: Dynamic Indexer with Disk Persistence
  * 
@@ -29,6 +34,21 @@ public:
      */
     void add_document(const std::string& document_text);
     
+    /**
+     * Attach the Stage 7 engine: each added document's vector is appended
+     * to its matrix and ANN index, and persisted with the other deltas so
+     * semantic scores survive a restart without a full rebuild.
+     * Attach before load_delta_index.
+     */
+    void use_semantic(std::shared_ptr<SemanticEngine> engine) { semantic = std::move(engine); }
+    
+    /**
+     * Attach the Stage 8 trie: each added document's terms are inserted
+     * (or re-ranked by their new DF) as one batched refresh, instead of
+     * rebuilding the trie from the whole lexicon.
+     */
+    void use_autocomplete(Autocomplete* trie) { autocomplete = trie; }
+    
     /**
      * Load delta index from disk on startup
      * Returns number of documents loaded
@@ -64,34 +84,47 @@ public:
      * Returns number of documents compacted
      */
     int compact_delta_to_static();
+    
+    /**
+     * Index generation counter, bumped by add_document and compaction
+     * Query-side caches compare against it to detect stale entries
+     */
+    uint64_t get_generation() const { return generation; }
+    const uint64_t* generation_counter() const { return &generation; }
 
 private:
     Lexicon& lexicon;
     ForwardIndex& forward_index;
     InvertedIndex& inverted_index; // Static index (read-only for new docs)
     Stage4Ranking& ranking;
+    std::shared_ptr<SemanticEngine> semantic; // optional
+    Autocomplete* autocomplete = nullptr;     // optional
     
     // Industry standard: Separate delta inverted index (LSM-style)
     std::unordered_map<int, std::vector<int>> delta_inv_index;
     
     int next_doc_id = 0; // Tracks next document ID to assign
     int static_doc_count = 0; // Original corpus size (for ID offset)
+    uint64_t generation = 0; // Bumped on every index mutation
     
     // Helper: Tokenize document text
     std::vector<std::string> tokenize(const std::string& text);
     
     // Disk persistence helper (private overload for single document)
-    void persist_to_disk(int doc_id, const std::vector<int>& term_ids, const std::unordered_set<int>& new_term_ids);
+    void persist_to_disk(int doc_id, const std::vector<int>& term_ids, const std::unordered_set<int>& new_term_ids,
+                         const float* doc_vector);
     
     // Disk persistence helpers
     void save_forward_delta(const std::string& filepath, int doc_id, const std::vector<int>& term_ids);
     void save_inverted_delta(const std::string& filepath, int term_id, const std::vector<int>& doc_ids);
     void save_lexicon_delta(const std::string& filepath, const std::string& token, int term_id);
     void save_stats(const std::string& filepath);
+    void save_vector_delta(const std::string& filepath, int doc_id, const float* vec);
     
     // Disk loading helpers
     void load_forward_delta(const std::string& filepath);
     void load_inverted_delta(const std::string& filepath);
     void load_lexicon_delta(const std::string& filepath);
     void load_stats(const std::string& filepath);
+    int load_vector_delta(const std::string& filepath);
 };
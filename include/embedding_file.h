@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "mapped_file.h"
+
+/**
+ * Stage 7: Binary embedding cache
+ *
+ * One-time conversion of a GloVe text file into a binary file that later
+ * starts memory-map instead of parsing:
+ *
+ *   EmbeddingFileHeader
+ *   | float matrix [num_words x dim], rows in GloVe order (64-byte aligned start)
+ *   | word bytes (concatenated, no separators)
+ *   | WordRef[num_words], sorted by word for binary search
+ *
+ * The header records the source file's size and mtime; a cache whose
+ * source has changed is treated as stale and rebuilt.
+ */
+struct EmbeddingFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t dim;
+    uint32_t reserved;
+    uint64_t num_words;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t matrix_offset;
+    uint64_t words_offset;
+    uint64_t index_offset;
+};
+static_assert(sizeof(EmbeddingFileHeader) == 64, "EmbeddingFileHeader must be packed to 64 bytes");
+
+struct WordRef {
+    uint64_t offset; // into the word bytes section
+    uint32_t length;
+    uint32_t row;    // matrix row
+};
+static_assert(sizeof(WordRef) == 16, "WordRef must be packed to 16 bytes");
+
+class EmbeddingFile {
+public:
+    static std::string cache_path(const std::string& glove_file) { return glove_file + ".bin"; }
+
+    // Parse the GloVe text once and write the binary cache (via a temp file + rename)
+    static bool convert(const std::string& glove_file, const std::string& cache_file, int dim);
+
+    /**
+     * Map the cache. Fails if it is missing, malformed, has a different
+     * dimension, or is stale with respect to glove_file (size/mtime).
+     * A missing glove_file is not treated as stale.
+     */
+    bool open(const std::string& cache_file, const std::string& glove_file, int dim);
+
+    bool is_open() const { return header != nullptr; }
+    size_t num_words() const { return header ? static_cast<size_t>(header->num_words) : 0; }
+
+    // Vector for word (binary search over the sorted word index), nullptr if absent
+    const float* find(const std::string& word) const;
+
+private:
+    MappedFile map;
+    const EmbeddingFileHeader* header = nullptr;
+    const float* matrix = nullptr;
+    const char* words = nullptr;
+    const WordRef* index = nullptr;
+};
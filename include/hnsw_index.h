@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "aligned_allocator.h"
+
+/**
+ * Stage 7: HNSW approximate nearest-neighbor index (Malkov & Yashunin)
+ *
+ * Graph over the rows of an external, unit-length vector matrix (the
+ * SemanticEngine document matrix); similarity is the dot product. The
+ * index stores only links, never a copy of the vectors.
+ *
+ *   m                max links per node on the upper layers (2*m on layer 0)
+ *   ef_construction  candidate list size while inserting (build quality)
+ *   ef_search        candidate list size while querying (recall vs latency)
+ *
+ * build() inserts in parallel: each node's link lists are guarded by a
+ * striped lock and a thread only ever holds one of them at a time.
+ * add() extends the graph one row at a time and must not run
+ * concurrently with search().
+ */
+struct HnswParams {
+    int m = 16;
+    int ef_construction = 200;
+    int ef_search = 64;
+};
+
+class HnswIndex {
+public:
+    HnswIndex(const AlignedFloatVector& vectors, size_t stride, const HnswParams& params);
+
+    // Index rows [0, num_vectors) of the matrix, replacing any existing graph
+    void build(size_t num_vectors, size_t num_threads);
+
+    // Index row `id` (already present in the matrix). Rows skipped between the
+    // current size and `id` become unreachable placeholder nodes.
+    void add(uint32_t id);
+
+    // Top-k rows by similarity as (row, similarity), best first. ef <= 0 uses params.ef_search.
+    std::vector<std::pair<int, float>> search(const float* query, size_t k, int ef = 0) const;
+
+    // Binary graph file; load() rejects files built with other parameters or over other vectors
+    bool save(const std::string& path) const;
+    bool load(const std::string& path, size_t num_vectors);
+
+    size_t size() const { return num_nodes; }
+    const HnswParams& get_params() const { return params; }
+    void set_ef_search(int ef) { params.ef_search = ef; }
+    size_t memory_bytes() const;
+
+private:
+    using Candidate = std::pair<float, uint32_t>; // (distance, row)
+
+    static constexpr size_t LOCK_STRIPES = 4096;
+
+    const AlignedFloatVector& vectors;
+    size_t stride;
+    HnswParams params;
+    int max_m0;        // layer-0 link capacity (2 * m)
+    double level_mult; // 1 / ln(m)
+
+    std::vector<int> levels;                       // top layer per node
+    std::vector<uint32_t> links0;                  // [num_nodes x (max_m0 + 1)]: count, then links
+    std::vector<std::vector<uint32_t>> upper_links; // per node: layers 1..level, each [count, m links]
+    size_t num_nodes = 0;
+    uint32_t entry_point = 0;
+    int max_level = -1;
+
+    mutable std::mutex graph_mutex; // entry point / max level
+    mutable std::array<std::mutex, LOCK_STRIPES> node_locks;
+    std::mt19937_64 rng{0x484E5357};
+
+    const float* row(uint32_t id) const { return vectors.data() + static_cast<size_t>(id) * stride; }
+    float distance(const float* a, uint32_t id) const;
+    std::mutex& lock_for(uint32_t id) const { return node_locks[id % LOCK_STRIPES]; }
+
+    int random_level();
+    void allocate_node(uint32_t id, int level);
+    uint32_t* link_list(uint32_t id, int level);
+    const uint32_t* link_list(uint32_t id, int level) const;
+    size_t max_links(int level) const { return level == 0 ? max_m0 : params.m; }
+    void copy_links(uint32_t id, int level, std::vector<uint32_t>& out) const;
+
+    void insert(uint32_t id);
+    uint32_t greedy_closest(const float* query, uint32_t ep, int level) const;
+    std::vector<Candidate> search_layer(const float* query, uint32_t ep, size_t ef, int level) const;
+    std::vector<Candidate> select_neighbors(const std::vector<Candidate>& sorted, size_t max_count) const;
+    void connect(uint32_t from, uint32_t to, int level);
+};
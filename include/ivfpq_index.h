@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Stage 7: IVF-PQ compressed vector index (inverted file + product quantization)
+ *
+ * Memory-bounded alternative to HnswIndex. Vectors are not kept:
+ *
+ *   - k-means splits the space into nlist coarse cells (centroids)
+ *   - each vector is stored in its cell's list as the PQ code of its residual
+ *     (vector - centroid): num_subquantizers bytes, one 256-entry codebook per
+ *     subspace, shared by all cells
+ *
+ * A query scans the nprobe cells nearest to it. Because similarity is the
+ * inner product, q.(c + r) = q.c + sum_s q_s.r_s, so one lookup table of
+ * q_s . codeword per query (ADC) scores every code with num_subquantizers
+ * table reads and no decoding.
+ */
+struct IvfPqParams {
+    int nlist = 0;                  // coarse cells (0: about 4 * sqrt(n))
+    int num_subquantizers = 16;     // code bytes per vector; must divide the vector stride
+    int nprobe = 8;                 // cells scanned per query
+    int train_iterations = 20;      // k-means iterations (coarse and PQ)
+    size_t max_train_points = 65536;
+};
+
+class IvfPqIndex {
+public:
+    IvfPqIndex(size_t stride, const IvfPqParams& params);
+
+    // Train centroids and codebooks on `vectors` (num_vectors x stride) and encode all of them
+    void train_and_add(const float* vectors, size_t num_vectors, size_t num_threads);
+
+    // Encode one more vector under `id` (codebooks stay fixed)
+    void add(uint32_t id, const float* vec);
+
+    // Top-k ids by approximate inner product as (id, score), best first. nprobe <= 0 uses params.nprobe.
+    std::vector<std::pair<int, float>> search(const float* query, size_t k, int nprobe = 0) const;
+
+    // Binary index file; load() rejects files built with other parameters or over other vectors
+    bool save(const std::string& path, uint64_t fingerprint) const;
+    bool load(const std::string& path, size_t num_vectors, uint64_t fingerprint);
+
+    size_t size() const { return num_vectors; }
+    const IvfPqParams& get_params() const { return params; }
+    size_t memory_bytes() const;
+
+private:
+    static constexpr size_t KSUB = 256; // codewords per subquantizer (one byte per code)
+
+    size_t stride;
+    size_t dsub; // dimensions per subquantizer
+    IvfPqParams params;
+
+    std::vector<float> centroids;        // [nlist x stride]
+    std::vector<float> centroid_norms;   // ||c||^2, for nearest-cell assignment
+    std::vector<float> codebooks;        // [num_subquantizers x KSUB x dsub]
+    std::vector<std::vector<uint32_t>> list_ids;
+    std::vector<std::vector<uint8_t>> list_codes; // [list size x num_subquantizers]
+    size_t num_vectors = 0;
+
+    size_t nearest_centroid(const float* vec) const;
+    void encode_residual(const float* residual, uint8_t* code) const;
+};
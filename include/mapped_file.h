@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+/**
+ * Read-only memory-mapped file (POSIX mmap / Win32 file mapping).
+ * The mapping stays valid until close() or destruction, so pointers into
+ * data() can be handed out as zero-copy views.
+ */
+class MappedFile {
+public:
+    enum class Access { Normal, Random, Sequential };
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map the whole file; returns false if it cannot be opened or mapped
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return opened; }
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+
+    // Access-pattern hint for the whole mapping (madvise; no-op on Windows)
+    void advise(Access access) const;
+
+    // Ask the OS to start reading a range into the page cache (non-blocking)
+    void prefetch(size_t offset, size_t len) const;
+
+private:
+    void swap(MappedFile& other) noexcept;
+
+    const char* ptr = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+/**
+ * Read-only file with positional reads (pread / overlapped ReadFile).
+ * There is no shared stream position, so read_at() is safe to call
+ * concurrently from multiple threads.
+ */
+class RandomAccessFile {
+public:
+    RandomAccessFile() = default;
+    ~RandomAccessFile() { close(); }
+
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+    RandomAccessFile(RandomAccessFile&& other) noexcept;
+    RandomAccessFile& operator=(RandomAccessFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    // Read up to len bytes at offset; returns the number of bytes read
+    size_t read_at(size_t offset, void* buffer, size_t len) const;
+
+private:
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "stage5_query_engine.h" // For SearchResult
+
+/**
+ * Stage 5: Query Result Cache
+ *
+ * Segmented LRU (SLRU) cache of final search results, keyed by the
+ * normalized (sorted) term-ID sequence of a query plus top_k and the
+ * cascade depths.
+ * New entries land in the probationary segment and are promoted to the
+ * protected segment on their second hit, so one-off tail queries cannot
+ * flush the Zipfian head out of the cache.
+ *
+ * Invalidation is generation based: every entry belongs to the index
+ * generation it was computed against. When the caller presents a newer
+ * generation (bumped by DynamicIndexer on add/compact), the cache is dropped.
+ */
+struct QueryCacheKey {
+    std::vector<int> term_ids; // sorted term IDs (duplicates kept)
+    int top_k = 0;
+    int first_phase_depth = 0; // cascade depths and fusion settings (SearchOptions)
+    int rescore_depth = 0;
+    int expansion_terms = 0;
+    float expansion_weight = 0.0f;
+    int fusion = 0;
+    int fusion_depth = 0;
+    float lexical_weight = 0.0f;
+
+    bool operator==(const QueryCacheKey& other) const {
+        return top_k == other.top_k && first_phase_depth == other.first_phase_depth &&
+               rescore_depth == other.rescore_depth && expansion_terms == other.expansion_terms &&
+               expansion_weight == other.expansion_weight && fusion == other.fusion &&
+               fusion_depth == other.fusion_depth && lexical_weight == other.lexical_weight &&
+               term_ids == other.term_ids;
+    }
+};
+
+struct QueryCacheKeyHash {
+    size_t operator()(const QueryCacheKey& key) const {
+        // FNV-1a over term IDs and options
+        uint64_t h = 1469598103934665603ULL;
+        auto mix = [&h](uint32_t v) {
+            for (int i = 0; i < 4; ++i) {
+                h ^= (v >> (i * 8)) & 0xFF;
+                h *= 1099511628211ULL;
+            }
+        };
+        for (int id : key.term_ids) mix(static_cast<uint32_t>(id));
+        mix(static_cast<uint32_t>(key.top_k));
+        mix(static_cast<uint32_t>(key.first_phase_depth));
+        mix(static_cast<uint32_t>(key.rescore_depth));
+        mix(static_cast<uint32_t>(key.expansion_terms));
+        mix(static_cast<uint32_t>(key.expansion_weight * 1000.0f));
+        mix(static_cast<uint32_t>(key.fusion));
+        mix(static_cast<uint32_t>(key.fusion_depth));
+        mix(static_cast<uint32_t>(key.lexical_weight * 1000.0f));
+        return static_cast<size_t>(h);
+    }
+};
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0; // generation changes that dropped the cache
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t capacity_bytes = 0;
+
+    double hit_rate() const {
+        uint64_t total = hits + misses;
+        return total ? static_cast<double>(hits) / total : 0.0;
+    }
+};
+
+class QueryCache {
+public:
+    // protected_ratio: share of the byte budget reserved for the protected segment
+    explicit QueryCache(size_t capacity_bytes, double protected_ratio = 0.8);
+
+    /**
+     * Look up cached results for key under the given index generation.
+     * Returns true and fills `out` on hit.
+     */
+    bool lookup(const QueryCacheKey& key, uint64_t generation, std::vector<SearchResult>& out);
+
+    /**
+     * Insert results computed against `generation`.
+     * Entries larger than the whole budget are not cached.
+     */
+    void insert(const QueryCacheKey& key, uint64_t generation, const std::vector<SearchResult>& results);
+
+    void clear();
+
+    QueryCacheStats get_stats() const;
+
+private:
+    enum class Segment { Probation, Protected };
+
+    struct Entry {
+        QueryCacheKey key;
+        std::vector<SearchResult> results;
+        size_t bytes = 0;
+        Segment segment = Segment::Probation;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static size_t estimate_bytes(const QueryCacheKey& key, const std::vector<SearchResult>& results);
+
+    // Drop everything if the index moved on since the cached entries were built
+    void sync_generation(uint64_t generation);
+
+    void promote(EntryList::iterator it);
+    void evict_to_fit();
+
+    size_t capacity_bytes;
+    size_t protected_capacity;
+    size_t probation_bytes = 0;
+    size_t protected_bytes = 0;
+    uint64_t current_generation = 0;
+
+    // Front = most recently used
+    EntryList probation;
+    EntryList protected_list;
+    std::unordered_map<QueryCacheKey, EntryList::iterator, QueryCacheKeyHash> index;
+
+    QueryCacheStats stats;
+};
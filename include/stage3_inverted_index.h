@@ -11,6 +11,9 @@ public:
     // Incremental update
     void add_document(int doc_id, const std::vector<int>& term_ids);
 
+    // Free all postings (barrels serve the static tier instead)
+    void release() { std::unordered_map<int,std::vector<int>>().swap(inv_index); }
+
 private:
     std::unordered_map<int,std::vector<int>> inv_index;
 };
\ No newline at end of file
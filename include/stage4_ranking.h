@@ -10,6 +10,9 @@ public:
 
     double score(int term_id, int doc_id) const;
 
+    // Sum of weight x BM25 over several terms, in one pass over the document
+    double score(const std::unordered_map<int,double>& term_weights, int doc_id) const;
+
     // ✅ Expose IDF map for semantic search
     const std::unordered_map<int,double>& get_idf_map() const { return idf_map; }
 
@@ -3,6 +3,7 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <cstdint>
 
 #include "stage1_lexicon.h"
 #include "stage2_forward_index.h"
@@ -12,6 +13,10 @@
 
 // Forward declaration for Stage 7
 class SemanticEngine;
+class QueryCache;
+class TieredPostingsStore;
+class ThreadPool;
+class TermExpansionTable;
 
 struct SearchResult {
     int doc_id;
@@ -19,28 +24,109 @@ struct SearchResult {
     std::string snippet;
 };
 
+// Hybrid retrieval: how lexical and vector (ANN) result lists are merged
+enum class HybridFusion {
+    None,           // lexical cascade only
+    ReciprocalRank, // sum of 1 / (60 + rank) over both lists
+    WeightedScore   // min-max normalized scores, lexical_weight * lex + (1 - lexical_weight) * vec
+};
+
+/**
+ * Cascade depths for one search. Each stage only sees the survivors of
+ * the previous one, so rerank cost is bounded by the depths, not by the
+ * number of matching documents:
+ *
+ *   1. candidate generation: term-match count over static + delta postings;
+ *      if more than first_phase_depth (N1) match, the N1 with the best BM25
+ *      are kept (by match count when no ranking is attached)
+ *   2. semantic rerank of those N1 (when a SemanticEngine is attached)
+ *   3. optional BM25 rescoring of the best rescore_depth (N2) from the
+ *      forward index (0: off; needs attach_ranking)
+ *
+ * With an expansion table attached, stage 1 also scores the postings of
+ * up to expansion_terms precomputed nearest terms per query term, each at
+ * expansion_weight x its cosine similarity (a query term counts 1).
+ *
+ * With a fusion mode, the semantic rerank is replaced by an ANN search
+ * for the query vector, run on a worker thread alongside stages 1 and 3.
+ * The top fusion_depth of each list are fused, so documents that share
+ * no term with the query can still be returned.
+ */
+struct SearchOptions {
+    int top_k = 5;
+    int first_phase_depth = 1000;
+    int rescore_depth = 0;
+    int expansion_terms = 3;
+    float expansion_weight = 0.5f;
+    HybridFusion fusion = HybridFusion::None;
+    int fusion_depth = 100;
+    float lexical_weight = 0.5f;
+};
+
+// Per-stage candidate counts and wall time of the last search
+struct SearchTiming {
+    bool cache_hit = false;
+    size_t expansions = 0;  // synonym terms added to the query
+    size_t matched = 0;     // documents matching any query term
+    size_t first_phase = 0; // kept after stage 1
+    size_t rescored = 0;    // rescored by stage 3
+    size_t vector_hits = 0; // hybrid: ANN results fused
+    double retrieval_us = 0.0;
+    double semantic_us = 0.0;
+    double rescore_us = 0.0;
+    double vector_us = 0.0; // hybrid: query embedding + ANN search (worker thread)
+    double fusion_us = 0.0;
+};
+
 class QueryEngine {
 public:
     // Constructor: only take references to Lexicon and InvertedIndex
     QueryEngine(const Lexicon& lex, const InvertedIndex& inv)
         : lexicon(lex), inv_index(inv) {}
+    ~QueryEngine();
 
     void attach_forward_index(const ForwardIndex& fwd) { fwd_index = &fwd; }
+    void attach_ranking(const Stage4Ranking& ranker) { ranking = &ranker; }
     void use_barrels(std::shared_ptr<BarrelsReader> reader) { barrels_reader = reader; }
+    // Tiered mode: hot terms from memory, long tail from barrels (takes precedence over use_barrels)
+    void use_tiered(std::shared_ptr<TieredPostingsStore> store) { tiered = store; }
     void use_semantic(std::shared_ptr<SemanticEngine> sem) { semantic = sem; }
+    void use_expansions(std::shared_ptr<TermExpansionTable> table) { expansions = table; }
     
     // Added for Stage 9 compatibility: Attach delta inverted index for query-time merging
     void attach_delta_index(const std::unordered_map<int, std::vector<int>>* delta_inv) {
         delta_inv_index = delta_inv;
     }
 
+    // Result cache, invalidated whenever the attached index generation changes
+    void use_cache(std::shared_ptr<QueryCache> qcache) { cache = qcache; }
+    void attach_index_generation(const uint64_t* generation) { index_generation = generation; }
+
     std::vector<SearchResult> search(const std::string& query, int top_k = 5);
+    std::vector<SearchResult> search(const std::string& query, const SearchOptions& options,
+                                     SearchTiming* timing = nullptr);
+
+    // Cascade depths used by search(query, top_k)
+    void set_default_options(const SearchOptions& options) { default_options = options; }
+    const SearchOptions& get_default_options() const { return default_options; }
 
 private:
     const Lexicon& lexicon;
     const InvertedIndex& inv_index; // Static inverted index
     const ForwardIndex* fwd_index = nullptr;
+    const Stage4Ranking* ranking = nullptr; // BM25 for the rescoring stage
     const std::unordered_map<int, std::vector<int>>* delta_inv_index = nullptr; // Delta inverted index (Stage 9)
     std::shared_ptr<BarrelsReader> barrels_reader;
+    std::shared_ptr<TieredPostingsStore> tiered;
     std::shared_ptr<SemanticEngine> semantic; // Stage 7 semantic search
+    std::shared_ptr<TermExpansionTable> expansions; // Stage 7 query expansion (optional)
+    std::shared_ptr<QueryCache> cache; // Result cache (optional)
+    const uint64_t* index_generation = nullptr; // Owned by DynamicIndexer
+    SearchOptions default_options;
+    std::unique_ptr<ThreadPool> vector_worker; // hybrid ANN searches (created on first use)
+
+    std::vector<SearchResult> execute(const std::vector<int>& query_term_ids, const SearchOptions& options,
+                                      bool semantic_rerank, SearchTiming& timing);
+    std::vector<SearchResult> execute_hybrid(const std::vector<int>& query_term_ids, const SearchOptions& options,
+                                             SearchTiming& timing);
 };
\ No newline at end of file
@@ -6,45 +6,354 @@
 #include <list>
 #include <memory>
 #include <iostream>
+#include <cstdint>
+#include <array>
+#include <mutex>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include "stage3_inverted_index.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
 
-// BarrelEntry holds the barrel file path and offset
+/**
+ * Stage 6 on-disk format (binary, little-endian, written by BarrelsWriter)
+ *
+ * barrel_<i>.bin : "BRL2" | build_id (uint64) | postings records
+ *                  record = count (uint32) | doc_ids (int32[count])
+ * manifest.bin   : ManifestHeader
+ *                  | barrel names (uint32 len + bytes each, relative to manifest dir)
+ *                  | padding to 8 bytes
+ *                  | BarrelEntry[num_slots], indexed directly by term ID
+ *                  | presence filters: per barrel, one bit per term ID in its
+ *                    range (uint64 words, barrel b covers [b*range_width, (b+1)*range_width))
+ *
+ * The manifest is memory-mapped, so startup cost and resident memory do not
+ * depend on vocabulary size; a term lookup is one array index. Absent terms
+ * are rejected by the 1-bit-per-term filter before the slot array is touched.
+ *
+ * Every barrel of a set carries the build_id of the manifest written with
+ * it. A set replaced only partly (e.g. a crash during COMPACT) mixes build
+ * IDs and is refused as a whole, since the manifest's offsets would point
+ * into the wrong records.
+ */
+static const char BARREL_MAGIC[4] = {'B', 'R', 'L', '2'};
+static const size_t BARREL_HEADER_SIZE = sizeof(BARREL_MAGIC) + sizeof(uint64_t); // keeps records 4-byte aligned
+static const char MANIFEST_MAGIC[4] = {'B', 'M', 'A', 'N'};
+static const uint32_t MANIFEST_VERSION = 5;
+
+struct ManifestHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t num_barrels;
+    uint32_t num_slots;      // max term ID + 1
+    uint32_t num_terms;      // slots that hold a postings list
+    uint32_t range_width;    // term IDs per barrel
+    uint64_t entries_offset; // byte offset of the BarrelEntry array
+    uint64_t filters_offset; // byte offset of the presence bitmaps
+    uint32_t num_documents;  // CorpusIdentity the barrels were written from
+    uint32_t lexicon_terms;
+    uint64_t corpus_fingerprint;
+    uint64_t build_id;       // stamped into every barrel of this set
+};
+static_assert(sizeof(ManifestHeader) == 64, "ManifestHeader must be packed to 64 bytes");
+
+/**
+ * The corpus a barrel set was written from. Barrels store bare doc and
+ * term IDs, so they are only meaningful for the same documents and the
+ * same lexicon numbering; callers compare against the live index before
+ * serving from them.
+ */
+struct CorpusIdentity {
+    uint32_t num_documents = 0;
+    uint32_t lexicon_terms = 0;
+    uint64_t fingerprint = 0; // FNV-1a over the lexicon (by term ID) and every document's term IDs
+
+    static CorpusIdentity of(const Lexicon& lex, const ForwardIndex& fwd);
+
+    bool operator==(const CorpusIdentity& other) const {
+        return num_documents == other.num_documents && lexicon_terms == other.lexicon_terms &&
+               fingerprint == other.fingerprint;
+    }
+    bool operator!=(const CorpusIdentity& other) const { return !(*this == other); }
+};
+
+// uint64 words in one barrel's presence bitmap
+inline size_t filter_words(uint32_t range_width) { return (static_cast<size_t>(range_width) + 63) / 64; }
+
+// Dense manifest slot: where a term's postings record lives and how many doc IDs it holds
 struct BarrelEntry {
-    std::string barrel_file;
-    size_t offset;
+    uint64_t offset;
+    uint32_t barrel; // index into the barrel-name table, NO_BARREL if the term is absent
+    uint32_t count;
+
+    static constexpr uint32_t NO_BARREL = 0xFFFFFFFFu;
+};
+static_assert(sizeof(BarrelEntry) == 16, "BarrelEntry must be packed to 16 bytes");
+
+// Zero-copy postings: points into a barrel mapping, or into a cached vector
+// kept alive by `owner` when the barrel could not be mapped.
+struct PostingsView {
+    const int* data = nullptr;
+    size_t size = 0;
+    std::shared_ptr<const std::vector<int>> owner;
+
+    const int* begin() const { return data; }
+    const int* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+    std::vector<int> to_vector() const { return std::vector<int>(begin(), end()); }
+};
+
+// Count-min sketch with periodic halving (TinyLFU frequency estimator)
+class FrequencySketch {
+public:
+    explicit FrequencySketch(size_t width = 4096);
+
+    void increment(int key);
+    int estimate(int key) const;
+
+private:
+    static constexpr int DEPTH = 4;
+    static constexpr uint8_t MAX_COUNT = 15;
+
+    size_t index_of(int key, int row) const;
+    void age(); // Halve all counters so old popularity fades
+
+    std::vector<uint8_t> counters; // DEPTH rows of `width` counters
+    size_t width;
+    size_t additions = 0;
+    size_t sample_size; // Age after this many increments
+};
+
+struct PostingsCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t rejections = 0; // Candidates refused by TinyLFU admission
+    uint64_t evictions = 0;
+    size_t bytes = 0;
+    size_t capacity_bytes = 0;
+};
+
+/**
+ * Byte-budgeted cache of decoded postings lists keyed by term ID.
+ * LRU eviction with TinyLFU admission: a new list only displaces the
+ * LRU victim if the sketch says it is accessed more often.
+ */
+class PostingsCache {
+public:
+    explicit PostingsCache(size_t capacity_bytes);
+
+    using Postings = std::shared_ptr<const std::vector<int>>;
+
+    // Records the access in the frequency sketch; returns nullptr on miss
+    Postings get(int term_id);
+    void put(int term_id, Postings postings);
+
+    void set_capacity(size_t bytes);
+    PostingsCacheStats get_stats() const { return stats; }
+
+private:
+    struct Entry {
+        int term_id;
+        Postings postings;
+        size_t bytes;
+    };
+
+    static size_t estimate_bytes(const std::vector<int>& postings);
+    void evict_lru();
+
+    size_t capacity_bytes;
+    size_t used_bytes = 0;
+    FrequencySketch sketch;
+    std::list<Entry> lru; // Front = most recently used
+    std::unordered_map<int, std::list<Entry>::iterator> index;
+    PostingsCacheStats stats;
 };
 
+/**
+ * Batch of postings fetches issued up front for one query.
+ * Lists are handed out in completion order, so the caller can start
+ * scoring the first list while the others are still being read.
+ */
+class PostingsFetch {
+public:
+    // Blocks until the next list is ready; returns false once all were consumed
+    bool next(int& term_id, PostingsView& view);
+
+private:
+    friend class BarrelsReader;
+
+    void complete(int term_id, PostingsView view);
+
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+    std::deque<std::pair<int, PostingsView>> ready;
+    size_t remaining = 0;
+};
+
+/**
+ * Lock-striped PostingsCache for concurrent readers.
+ * Term IDs hash to one of NUM_SHARDS independent caches, each with its own
+ * mutex and an equal share of the byte budget.
+ */
+class ShardedPostingsCache {
+public:
+    static constexpr size_t NUM_SHARDS = 16;
+
+    explicit ShardedPostingsCache(size_t capacity_bytes);
+
+    PostingsCache::Postings get(int term_id);
+    void put(int term_id, PostingsCache::Postings postings);
+
+    void set_capacity(size_t bytes);
+    PostingsCacheStats get_stats() const;
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        PostingsCache cache{0};
+    };
+
+    Shard& shard_for(int term_id) { return shards[static_cast<uint32_t>(term_id) % NUM_SHARDS]; }
+
+    std::array<Shard, NUM_SHARDS> shards;
+};
+
+/**
+ * Stage 6: Barrels reader
+ * Every barrel is memory-mapped once when the manifest is loaded, with a
+ * random-access hint; fetching postings is then a pointer computation and
+ * the OS page cache decides what stays resident. Barrels that cannot be
+ * mapped fall back to positional reads behind the decoded postings cache.
+ *
+ * Thread safety: after construction the manifest and mappings are
+ * read-only, the fallback path uses pread (no shared stream position)
+ * and the postings cache is lock-striped, so get_postings_view() may be
+ * called concurrently.
+ */
 class BarrelsReader {
 public:
+    static constexpr size_t DEFAULT_POSTINGS_CACHE_BYTES = 64 * 1024 * 1024;
+
     // Constructor: optionally load manifest file
-    BarrelsReader() : max_cache_size(5) {}
-    BarrelsReader(const std::string& manifest_file) : max_cache_size(5) {
-        std::ifstream fin(manifest_file);
-        if (!fin.is_open()) {
-            std::cerr << "Cannot open manifest file: " << manifest_file << "\n";
-            return;
-        }
+    BarrelsReader() : postings_cache(DEFAULT_POSTINGS_CACHE_BYTES) {}
+    BarrelsReader(const std::string& manifest_file) : postings_cache(DEFAULT_POSTINGS_CACHE_BYTES) {
+        load_manifest(manifest_file);
+    }
 
-        int term_id;
-        std::string barrel_file;
-        size_t offset;
-        while (fin >> term_id >> barrel_file >> offset) {
-            manifest[term_id] = {barrel_file, offset};
-        }
+    // True once a manifest has been loaded
+    bool is_loaded() const { return num_present > 0; }
+
+    /**
+     * Presence filter check: false means the term has no postings in any
+     * barrel (exact for range-partitioned barrels, no false positives).
+     */
+    bool may_contain(int term_id) const {
+        if (term_id < 0 || !filters || range_width == 0) return false;
+        uint32_t barrel = static_cast<uint32_t>(term_id) / range_width;
+        if (barrel >= barrels.size()) return false;
+        uint32_t bit = static_cast<uint32_t>(term_id) % range_width;
+        const uint64_t* words = filters + barrel * filter_words(range_width);
+        return (words[bit / 64] >> (bit % 64)) & 1;
     }
+    size_t num_terms() const { return num_present; }
+    size_t num_barrels() const { return barrels.size(); }
+    const CorpusIdentity& corpus() const { return corpus_identity; }
 
-    // Get postings for a term_id
-    std::vector<int> get_postings(int term_id);
+    // Every term ID with postings, ascending
+    std::vector<int> term_ids() const;
+
+    // Zero-copy postings for a term_id (empty view if unknown)
+    PostingsView get_postings_view(int term_id);
+
+    // Get postings for a term_id as an owned copy
+    std::vector<int> get_postings(int term_id) { return get_postings_view(term_id).to_vector(); }
+
+    /**
+     * Issue all term fetches at once. Readahead hints for every range are
+     * submitted first, then the I/O pool faults in (or preads) each list in
+     * parallel, so per-query disk latency is max-of-terms rather than the sum.
+     */
+    std::shared_ptr<PostingsFetch> fetch_async(const std::vector<int>& term_ids);
+
+    void set_postings_cache_bytes(size_t bytes) { postings_cache.set_capacity(bytes); }
+    PostingsCacheStats get_postings_cache_stats() const { return postings_cache.get_stats(); }
 
 private:
-    // Open barrel file with caching (LRU)
-    std::shared_ptr<std::ifstream> open_barrel(const std::string& barrel_file);
-
-    // Barrel manifest
-    std::unordered_map<int, BarrelEntry> manifest;
-
-    // LRU cache: filename -> (ifstream, iterator in LRU list)
-    std::unordered_map<std::string,
-        std::pair<std::shared_ptr<std::ifstream>, std::list<std::string>::iterator>> file_cache;
-    std::list<std::string> lru_list;
-    size_t max_cache_size;
-};
\ No newline at end of file
+    void load_manifest(const std::string& manifest_file);
+
+    // Drop the manifest and every barrel (nothing is served afterwards)
+    void unload();
+
+    // Manifest slot for term_id, nullptr if absent
+    const BarrelEntry* find_entry(int term_id) const {
+        if (!may_contain(term_id) || static_cast<uint32_t>(term_id) >= num_slots) return nullptr;
+        const BarrelEntry* entry = &entries[term_id];
+        return entry->barrel < barrels.size() ? entry : nullptr;
+    }
+
+    // Fallback path for barrels that could not be mapped
+    PostingsView read_postings(int term_id, const BarrelEntry& entry);
+
+    // Fetch and touch every page so later scoring never blocks on a fault
+    PostingsView load_postings(int term_id);
+
+    struct Barrel {
+        std::string path;
+        MappedFile map;
+        RandomAccessFile file; // only when mapping failed
+    };
+
+    // Barrel manifest (dense slot array inside the mapping)
+    MappedFile manifest_map;
+    const BarrelEntry* entries = nullptr;
+    uint32_t num_slots = 0;
+    size_t num_present = 0;
+    const uint64_t* filters = nullptr;
+    uint32_t range_width = 0;
+    CorpusIdentity corpus_identity;
+    std::vector<Barrel> barrels;
+
+    // Decoded postings lists for hot terms (unmapped barrels only)
+    ShardedPostingsCache postings_cache;
+
+    // I/O workers for fetch_async (created with the manifest; destroyed first)
+    static constexpr size_t IO_THREADS = 4;
+    std::unique_ptr<ThreadPool> io_pool;
+};
+
+/**
+ * Stage 6: Barrel writer
+ * Partitions the inverted index into N barrel files by contiguous term-ID
+ * range and writes the binary manifest that BarrelsReader loads.
+ */
+class BarrelsWriter {
+public:
+    explicit BarrelsWriter(int num_barrels) : num_barrels(num_barrels > 0 ? num_barrels : 1) {}
+
+    // Returns false if any file could not be written
+    bool write(const InvertedIndex& inv, const CorpusIdentity& corpus, const std::string& out_dir);
+
+    /**
+     * Compaction: write base's postings merged with the delta postings,
+     * one term at a time, so no full inverted index is held in memory.
+     * out_dir must differ from base's directory (its files stay mapped);
+     * move the result into place with replace() once base is released.
+     */
+    bool write_merged(BarrelsReader& base, const std::unordered_map<int, std::vector<int>>& delta,
+                      const CorpusIdentity& corpus, const std::string& out_dir);
+
+    // Move a barrel set written to staging_dir over the one in dir (manifest last; a partial
+    // move leaves mismatched build IDs, which BarrelsReader refuses)
+    static bool replace(const std::string& staging_dir, const std::string& dir, int num_barrels);
+
+    static std::string manifest_path(const std::string& dir) { return dir + "/manifest.bin"; }
+    static std::string barrel_name(int barrel) { return "barrel_" + std::to_string(barrel) + ".bin"; }
+
+private:
+    // Writes the sorted term_ids, taking each list from postings_of
+    bool write_terms(const std::vector<int>& term_ids, const std::function<std::vector<int>(int)>& postings_of,
+                     const CorpusIdentity& corpus, const std::string& out_dir);
+
+    int num_barrels;
+};
@@ -1,28 +1,195 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <list>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "aligned_allocator.h"
 #include "stage4_ranking.h"
 #include "stage5_query_engine.h" // For SearchResult
 
+class EmbeddingFile;
+class ForwardIndex;
+class HnswIndex;
+struct HnswParams;
+class IvfPqIndex;
+struct IvfPqParams;
+
+// Storage format of the document vectors used by rerank and brute-force search
+enum class VectorStorage {
+    Float32, // 4 bytes per dimension
+    Float16, // 2 bytes per dimension (IEEE half)
+    Int8     // 1 byte per dimension plus one float scale per document
+};
+
 class SemanticEngine {
 public:
-    SemanticEngine(const std::string& glove_file, int dim);
-
-    void build_document_vectors(const std::vector<std::string>& documents,
-                                const Lexicon& lex,
-                                const Stage4Ranking& ranker);
-
-    void rerank(const std::string& query,
-                std::vector<SearchResult>& results,
-                const Lexicon& lex,
-                const Stage4Ranking& ranker);
-    
-    // Semantic search for debug mode (returns cosine similarity scores)
+    /**
+     * Load GloVe vectors for the words in `lex` only, as one contiguous
+     * float32 matrix indexed by term ID. With keep_oov, the remaining
+     * GloVe words go into a separate out-of-vocabulary table so query-only
+     * (or later-added) words still get a vector.
+     *
+     * Vectors are read from the binary cache next to glove_file
+     * (EmbeddingFile::cache_path), which is built from the text on first
+     * use and rebuilt when the text changes; the text parser is only the
+     * fallback when the cache cannot be written. The cache stays mapped
+     * for terms the lexicon gains later (add_new_terms).
+     */
+    SemanticEngine(const std::string& glove_file, int dim, const Lexicon& lex, bool keep_oov = false);
+    ~SemanticEngine();
+
+    // Select the document vector format; takes effect at the next build_document_vectors
+    void set_vector_storage(VectorStorage format) { storage = format; }
+    VectorStorage get_vector_storage() const { return storage; }
+
+    /**
+     * Average term embedding for documents [0, num_documents), from the
+     * forward index's term IDs (no re-tokenization, no string hashing).
+     * Document ranges are processed in parallel straight into the
+     * preallocated matrix (and its quantized copy).
+     */
+    void build_document_vectors(const ForwardIndex& fwd_index, size_t num_documents, size_t num_threads);
+
+    // Blend cosine similarity with a unit-length query vector into the scores of `results`, in place
+    void rerank(const float* query_vec, std::vector<SearchResult>& results) const;
+
+    // Semantic search for debug mode (returns cosine similarity scores; uses the ANN index when built)
     std::vector<SearchResult> semantic_search(const std::string& query, int top_k = 5);
 
+    /**
+     * Unit-length query vector for resolved query term IDs, computed once
+     * and kept in a small LRU keyed by the sorted ID sequence, so rerank,
+     * hybrid retrieval and expansion of one query share it. Thread-safe.
+     */
+    std::shared_ptr<const AlignedFloatVector> query_embedding(const std::vector<int>& term_ids) const;
+    void set_query_cache_capacity(size_t entries);
+    uint64_t query_cache_hits() const;
+    uint64_t query_cache_misses() const;
+
+    /**
+     * Build (or load from index_file, if it matches the current document
+     * vectors and parameters) an HNSW index over the document vectors, and
+     * save it back when rebuilt. semantic_search uses it from then on.
+     */
+    void build_ann_index(const HnswParams& params, const std::string& index_file, size_t num_threads);
+
+    // Same for the compressed IVF-PQ index (replaces an HNSW index if one was built)
+    void build_ivfpq_index(const IvfPqParams& params, const std::string& index_file, size_t num_threads);
+
+    bool has_ann_index() const { return hnsw != nullptr || ivfpq != nullptr; }
+    size_t ann_memory_bytes() const;
+
+    /**
+     * Top-k documents for a unit-length query vector: brute force, or the
+     * ANN index with search_width as HNSW efSearch / IVF-PQ nprobe (0: default).
+     */
+    std::vector<SearchResult> search_vector(const float* query_vec, int top_k, bool exact, int search_width = 0) const;
+
+    // Unit-length vector of a document (decoded if quantized) into out[0..row_stride); false if out of range
+    bool document_vector(int doc_id, float* out) const;
+    size_t vector_stride() const { return row_stride; }
+
+    /**
+     * With a quantized storage format, drop the float32 copy of the
+     * document vectors once the ANN index has been built from it. Kept
+     * (returns false) when the format is Float32 or an HNSW graph needs it.
+     */
+    bool release_float_vectors();
+    size_t document_memory_bytes() const;
+
+    /**
+     * Offline job: write the k nearest terms of every lexicon term (by
+     * embedding cosine) to a TermExpansionTable file.
+     */
+    bool build_expansion_table(const std::string& path, int k, size_t num_threads) const;
+
+    // Identity of the term embedding matrix, recorded in expansion tables built from it
+    uint64_t embedding_fingerprint() const;
+
+    // L2-normalized average vector of a term ID sequence, padded to row_stride
+    AlignedFloatVector embed_terms(const std::vector<int>& term_ids) const;
+
+    /**
+     * Append the unit-length vector (row_stride floats) of a dynamically
+     * added document and insert it into the ANN index. IDs must grow;
+     * returns false for an ID that already has a vector.
+     */
+    bool add_document_vector(int doc_id, const float* vec);
+
+    /**
+     * Give lexicon terms added since load (Stage 9) their GloVe vector,
+     * growing the term matrix; returns how many were found. Call before
+     * embedding a document with new terms (not concurrently with queries).
+     * Without the binary cache only the OOV table, if kept, is searched.
+     */
+    size_t add_new_terms();
+
+    // Embedding row for a lexicon term (nullptr if GloVe has no vector for it)
+    const float* term_vector(int term_id) const;
+
+    // Embedding for an arbitrary lowercase token (lexicon matrix first, then OOV table)
+    const float* token_vector(const std::string& token) const;
+
+    size_t num_embedded_terms() const { return embedded_terms; }
+    size_t num_documents() const { return num_docs; }
+    size_t embedding_memory_bytes() const;
+
 private:
-    int dimension; // <-- declare dimension here
-    std::unordered_map<std::string, std::vector<double>> embeddings;
-    std::vector<std::vector<double>> doc_vectors;
-};
\ No newline at end of file
+    const Lexicon& lexicon;
+    int dimension;
+    int row_stride; // dimension padded to a multiple of 16 floats: every row starts on a 64-byte boundary
+
+    AlignedFloatVector embedding_matrix; // [num_rows x row_stride], row = lexicon term ID
+    std::vector<uint8_t> has_embedding;  // per row
+    size_t embedded_terms = 0;
+
+    // Mapped binary cache (nullptr on the text path), for add_new_terms and OOV lookups
+    std::unique_ptr<EmbeddingFile> glove_cache;
+
+    // Optional out-of-vocabulary table: served from glove_cache, or a copied table on the text path
+    bool keep_oov = false;
+    std::unordered_map<std::string, int> oov_rows;
+    AlignedFloatVector oov_matrix;
+
+    // Unit-length document vectors [num_docs x row_stride]: cosine similarity is a plain dot product
+    AlignedFloatVector doc_matrix;
+    size_t num_docs = 0;
+    bool float_rows_released = false;
+
+    // Quantized copies of doc_matrix (same layout), used for scoring when storage != Float32
+    VectorStorage storage = VectorStorage::Float32;
+    std::vector<uint16_t, AlignedAllocator<uint16_t, 64>> doc_f16;
+    std::vector<int8_t, AlignedAllocator<int8_t, 64>> doc_i8;
+    std::vector<float> doc_scales; // int8: value = code * scale
+
+    // Approximate index for semantic_search (at most one is built)
+    std::unique_ptr<HnswIndex> hnsw;
+    std::unique_ptr<IvfPqIndex> ivfpq;
+
+    // Query vector LRU (most recent first); term embeddings never change, so entries never go stale
+    struct TermIdsHash {
+        size_t operator()(const std::vector<int>& ids) const;
+    };
+    using QueryVectorEntry = std::pair<std::vector<int>, std::shared_ptr<const AlignedFloatVector>>;
+    mutable std::mutex query_cache_mutex;
+    mutable std::list<QueryVectorEntry> query_lru;
+    mutable std::unordered_map<std::vector<int>, std::list<QueryVectorEntry>::iterator, TermIdsHash> query_lookup;
+    size_t query_cache_capacity = 1024;
+    mutable uint64_t query_hits = 0;
+    mutable uint64_t query_misses = 0;
+
+    void load_from_cache(const EmbeddingFile& cache);
+    void load_from_text(const std::string& glove_file, bool keep_oov);
+
+    // Average of the term vectors into out[0..row_stride) (zero vector if none found)
+    void average_terms(const std::vector<int>& term_ids, float* out) const;
+
+    // Write the quantized copy of a unit-length row (buffers already sized)
+    void store_quantized(size_t doc_id, const float* row);
+
+    // Cosine of a unit-length query with a document, in the configured storage format
+    float document_similarity(const float* query_vec, size_t doc_id) const;
+};
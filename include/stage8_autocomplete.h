@@ -1,17 +1,25 @@
 #pragma once
+#include <cstdint>
 #include <string>
-#include <vector>
-#include <memory>
 #include <unordered_map>
+#include <vector>
 #include <sstream>
 #include "stage1_lexicon.h"
 
-// Trie node
+/**
+ * Radix trie node (16 bytes). Edges are path-compressed: each node holds
+ * the label of the edge leading to it as a slice of the shared label
+ * buffer. A node's children occupy nodes[first_child, first_child +
+ * num_children), sorted by the first byte of their labels.
+ */
 struct TrieNode {
-    std::unordered_map<char, std::shared_ptr<TrieNode>> children;
-    bool is_word = false;
-    std::string word;
+    uint32_t label_offset;
+    uint32_t first_child;
+    int32_t word;          // NOT_A_WORD, or the word's index in word_nodes/word_terms
+    uint16_t label_length;
+    uint16_t num_children;
 };
+static_assert(sizeof(TrieNode) == 16, "TrieNode must be packed to 16 bytes");
 
 class Autocomplete {
 public:
@@ -20,17 +28,114 @@ public:
         : documents(docs), lexicon(lex) { }
 
     void build_trie();
-    
+
     // Added for Stage 9 compatibility: Rebuild trie from Lexicon (not documents)
     // Industry standard: Autocomplete should reflect lexicon, not static corpus
     void rebuild_from_lexicon();
-    
+
+    /**
+     * Incremental updates for documents added at runtime. Both touch only
+     * the path from the root to the term: insert_term adds the word (at
+     * most one edge split or one child block moved to the end of the node
+     * array) and update_weight re-ranks it in its ancestors' top-k lists
+     * after its df changed. Inserting an existing word updates its weight.
+     */
+    void insert_term(const std::string& term);
+    bool update_weight(const std::string& term);
+
+    // Batched refresh for bulk ingestion: small batches go through insert_term,
+    // batches that are a large share of the vocabulary rebuild from the lexicon
+    void refresh_terms(const std::vector<std::string>& terms);
+
     std::vector<std::string> get_suggestions(const std::string& prefix, int max_suggestions = 5);
 
+    /**
+     * Typo-tolerant completion: words with a prefix within max_edits
+     * (Levenshtein, at most MAX_FUZZY_EDITS) of the typed prefix, ranked by
+     * edits, then df, then word. The trie is walked best-first with one
+     * edit-distance row per frontier node; a subtree is dropped once its
+     * row exceeds max_edits, or once k results beat its bound (row minimum,
+     * best df below it from the top-k lists). The walk stops after
+     * budget_us microseconds and returns what it has, setting *truncated.
+     */
+    static constexpr int MAX_FUZZY_EDITS = 2;
+    std::vector<std::string> get_fuzzy_suggestions(const std::string& prefix, int max_suggestions = 5,
+                                                   int max_edits = 1, int budget_us = 2000,
+                                                   bool* truncated = nullptr) const;
+
+    size_t num_words() const { return word_nodes.size(); }
+    size_t memory_bytes() const {
+        return nodes.capacity() * sizeof(TrieNode) + labels.capacity() +
+               (parents.capacity() + top_offset.capacity() + top_lists.capacity() + word_nodes.capacity() +
+                word_terms.capacity()) * sizeof(uint32_t);
+    }
+
 private:
+    static constexpr int32_t NOT_A_WORD = -2;
+
+    // Completions precomputed per node, ranked by df descending (ties in word order).
+    // Only nodes with more than TOP_K words below them get a list; smaller subtrees are walked.
+    static constexpr size_t TOP_K = 10;
+
+    // refresh_terms rebuilds once a batch exceeds 1/REBUILD_FRACTION of the vocabulary
+    static constexpr size_t REBUILD_FRACTION = 4;
+
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
     const Lexicon& lexicon;
     const std::vector<std::string>& documents;
-    std::shared_ptr<TrieNode> root = std::make_shared<TrieNode>();
 
-    void dfs(std::shared_ptr<TrieNode> node, std::vector<std::pair<std::string, int>>& result);
-};
\ No newline at end of file
+    // Flat radix trie, bulk-loaded from sorted words; nodes[0] is the root.
+    // Inserts append nodes and leave the slots they replace unreachable;
+    // once those outnumber the live nodes the trie is bulk-loaded again.
+    std::vector<TrieNode> nodes;
+    std::string labels;
+    size_t dead_nodes = 0;
+
+    std::vector<uint32_t> parents;    // per node (root: itself)
+    std::vector<uint32_t> top_offset; // per node: 0, or the index of its list in top_lists
+    std::vector<uint32_t> top_lists;  // per list: count, then TOP_K word slots best first ([0] unused)
+
+    // Per word; word IDs stay put when inserts move nodes, so the lists hold words
+    std::vector<uint32_t> word_nodes;
+    std::vector<int32_t> word_terms;  // lexicon ID, -1 if the word is not in the lexicon
+
+    struct Completion {
+        int df;
+        uint32_t ordinal; // position in sorted word order
+        uint32_t word;
+    };
+
+    // Sorted, unique words -> nodes/labels
+    void bulk_load(std::vector<std::string>& words);
+    void build_children(uint32_t node, const std::vector<std::string>& words, size_t lo, size_t hi, size_t depth);
+
+    // Best TOP_K completions of the subtree into out (and its stored list, if large); returns its word count
+    size_t precompute_top(uint32_t node, uint32_t& ordinal, std::vector<Completion>& out);
+    std::string word_at(uint32_t node) const;
+    int word_df(uint32_t word) const;
+    bool better_word(uint32_t a, uint32_t b) const;
+
+    // Node reached by spelling prefix (which may end inside its label), NO_NODE if none;
+    // word receives the full path spelling of that node
+    uint32_t descend(const std::string& prefix, std::string& word) const;
+
+    // Incremental maintenance
+    uint32_t insert_word(const std::string& word);
+    void move_node(uint32_t from, uint32_t to);
+    uint32_t add_child(uint32_t node, uint32_t slot, const std::string& word, size_t pos);
+    void split_node(uint32_t node, size_t at);
+    void rerank_path(uint32_t word);
+    void rerank(uint32_t node, uint32_t word);
+    void refresh_list(uint32_t node);
+    void rebuild_list(uint32_t node);
+    size_t count_words(uint32_t node, size_t limit) const;
+    void collect_words(uint32_t node, std::vector<uint32_t>& out) const;
+    void compact();
+
+    // Fuzzy completion helpers
+    int best_df(uint32_t node) const;
+    void add_fuzzy_matches(uint32_t node, int edits, size_t k, std::unordered_map<uint32_t, int>& matches) const;
+
+    void dfs(uint32_t node, std::string& word, std::vector<std::pair<std::string, int>>& result) const;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+/**
+ * Stage 7: Precomputed query expansion table
+ *
+ * For every lexicon term, its k nearest other terms by embedding cosine
+ * similarity. Built offline (--build-expansions) and memory-mapped at
+ * query time, so expanding a query costs one table lookup per term:
+ *
+ *   TermExpansionHeader
+ *   | ExpansionEntry[num_terms x k], row = term ID, best first
+ *
+ * Unused slots (terms with fewer than k positive neighbors, or without an
+ * embedding) have term_id -1. The header records a fingerprint of the
+ * embedding matrix; open() rejects a table built from other vectors.
+ */
+struct TermExpansionHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t k;
+    uint32_t reserved;
+    uint64_t num_terms;
+    uint64_t fingerprint;
+    uint64_t entries_offset;
+};
+static_assert(sizeof(TermExpansionHeader) == 40, "TermExpansionHeader must be packed to 40 bytes");
+
+struct ExpansionEntry {
+    int32_t term_id;
+    float similarity;
+};
+static_assert(sizeof(ExpansionEntry) == 8, "ExpansionEntry must be packed to 8 bytes");
+
+class TermExpansionTable {
+public:
+    /**
+     * Compute the table and write it to path (via a temp file + rename).
+     * rows holds the unit-length embeddings [row_terms.size() x stride] of
+     * the terms listed in row_terms; other term IDs below num_terms get
+     * empty rows. Similarities are a blocked all-pairs matrix multiply,
+     * split across num_threads.
+     */
+    static bool build(const float* rows, const std::vector<int>& row_terms, size_t stride, size_t num_terms,
+                      int k, size_t num_threads, uint64_t fingerprint, const std::string& path);
+
+    bool open(const std::string& path, uint64_t fingerprint);
+
+    bool is_open() const { return header != nullptr; }
+    size_t num_terms() const { return header ? static_cast<size_t>(header->num_terms) : 0; }
+    int k() const { return header ? static_cast<int>(header->k) : 0; }
+
+    // The k neighbor slots of term_id (best first), nullptr for terms outside the table
+    const ExpansionEntry* neighbors(int term_id) const;
+
+private:
+    MappedFile map;
+    const TermExpansionHeader* header = nullptr;
+    const ExpansionEntry* entries = nullptr;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed-size worker pool.
+ * Tasks run in FIFO order; submit() returns a future for the task's result.
+ * The destructor finishes all queued tasks before joining the workers.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.emplace_back([packaged]() { (*packaged)(); });
+        }
+        cv.notify_one();
+        return result;
+    }
+
+    size_t size() const { return workers.size(); }
+
+    /**
+     * Run fn(begin, end) over [0, n) split into one contiguous range per
+     * worker and wait for all of them. Runs inline on the calling thread
+     * for a single-worker pool or when n is below min_parallel. Must not
+     * be called from one of this pool's own tasks.
+     */
+    void parallel_for(size_t n, const std::function<void(size_t, size_t)>& fn, size_t min_parallel = 1024);
+
+    // Hardware concurrency with a floor of 1
+    static size_t default_threads();
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+};
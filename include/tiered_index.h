@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "stage1_lexicon.h"
+#include "stage6_barrels.h"
+
+struct TieredStats {
+    uint64_t hot_hits = 0;
+    uint64_t cold_hits = 0;
+    uint64_t promotions = 0;
+    uint64_t demotions = 0;
+    size_t hot_terms = 0;
+    size_t hot_bytes = 0;
+    size_t budget_bytes = 0;
+};
+
+/**
+ * Stage 6: Hybrid tiered postings storage
+ *
+ * Hot tier: postings of the most frequently queried terms, copied into
+ * memory up to a RAM budget. Cold tier: everything else, served from the
+ * mmapped barrels. The hot tier starts from the highest-df terms and is
+ * rebalanced online from observed access counts: every REBALANCE_INTERVAL
+ * lookups, cold terms accessed more often than the coldest resident terms
+ * are promoted and those residents demoted. Counts are halved after each
+ * rebalance so the split follows shifts in query traffic.
+ */
+class TieredPostingsStore {
+public:
+    static constexpr uint64_t REBALANCE_INTERVAL = 1024;
+
+    TieredPostingsStore(std::shared_ptr<BarrelsReader> cold, size_t ram_budget_bytes);
+
+    // Initial split: keep the highest-df terms resident until the budget is full
+    void warm_from_df(const Lexicon& lex);
+
+    /**
+     * Record an access to term_id and return its postings if resident.
+     * Returns false for cold terms; the caller fetches them from barrels().
+     */
+    bool lookup_hot(int term_id, PostingsView& out);
+
+    // Promote/demote if enough accesses were recorded since the last pass
+    void maybe_rebalance();
+
+    BarrelsReader& barrels() { return *cold_tier; }
+
+    void set_budget(size_t bytes);
+    TieredStats get_stats() const;
+
+private:
+    using Postings = std::shared_ptr<const std::vector<int>>;
+
+    static size_t postings_bytes(size_t count);
+
+    void rebalance();
+    bool promote(int term_id);
+    void demote(int term_id);
+
+    std::shared_ptr<BarrelsReader> cold_tier;
+    size_t budget_bytes;
+    size_t hot_bytes = 0;
+
+    std::unordered_map<int, Postings> hot_tier;
+    std::unordered_map<int, uint32_t> access_counts;
+    uint64_t accesses_since_rebalance = 0;
+
+    mutable std::mutex mutex;
+    TieredStats stats;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Float vector kernels for Stage 7 similarity.
+ *
+ * Each function dispatches once (on first use) to the widest kernel the
+ * CPU and OS support: AVX-512F, then AVX2+FMA, then a portable scalar
+ * loop. The SIMD kernels are compiled with per-function target attributes
+ * (GCC/Clang) or plain intrinsics (MSVC), so the binary still runs on
+ * machines without AVX and no global -mavx2 flag is needed.
+ *
+ * Inputs do not need to be aligned, but rows from AlignedFloatVector
+ * padded to a multiple of 16 floats avoid the tail loop entirely.
+ */
+
+// Dot product of a[0..n) and b[0..n)
+float dot_product(const float* a, const float* b, size_t n);
+
+// Dot product of float q with fp16 (IEEE binary16 bit patterns) v; the AVX2 path also requires F16C
+float dot_product_f16(const float* q, const uint16_t* v, size_t n);
+
+// Dot product of float q with int8 v (the caller applies the vector's scale)
+float dot_product_i8(const float* q, const int8_t* v, size_t n);
+
+// Round-to-nearest-even float <-> fp16 conversion
+uint16_t float_to_half(float f);
+float half_to_float(uint16_t h);
+
+// out[r] = dot_product(q, rows + r * stride, n) for r in [0, num_rows)
+void dot_product_batch(const float* q, const float* rows, size_t stride, size_t num_rows, size_t n, float* out);
+
+// Scale v to unit L2 norm in place and return the original norm (a zero vector is left as is)
+float normalize_l2(float* v, size_t n);
+
+// FNV-1a over the shape and every row: identity check for persisted vector indexes and tables
+uint64_t matrix_fingerprint(const float* rows, size_t num_rows, size_t stride);
+
+// Name of the kernel selected for this CPU ("avx512", "avx2" or "scalar")
+const char* vector_kernel_name();
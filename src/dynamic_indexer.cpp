@@ -1,4 +1,6 @@
 #include "dynamic_indexer.h"
+#include "stage7_semantic.h"
+#include "stage8_autocomplete.h"
 #include <iostream>
 #include <cctype>
 #include <sstream>
@@ -78,6 +80,15 @@ void DynamicIndexer::add_document(const std::string& document_text) {
         lexicon.increment_df(term_id);
     }
     
+    // Autocomplete: new terms are inserted, existing ones re-ranked by their new DF
+    if (autocomplete) {
+        std::vector<std::string> changed_terms;
+        for (int term_id : unique_terms) {
+            if (term_id >= 0) changed_terms.push_back(lexicon.get_term_string(term_id));
+        }
+        autocomplete->refresh_terms(changed_terms);
+    }
+    
     // Add to forward index
     forward_index.add_document(doc_id, term_ids);
     
@@ -90,9 +101,19 @@ void DynamicIndexer::add_document(const std::string& document_text) {
     // Update ranking stats
     ranking.update_stats();
     
+    // Semantic vector (appended to the document matrix and ANN index)
+    AlignedFloatVector doc_vector;
+    if (semantic) {
+        if (!new_term_ids.empty()) semantic->add_new_terms(); // new vocabulary gets its GloVe vector
+        doc_vector = semantic->embed_terms(term_ids);
+        semantic->add_document_vector(doc_id, doc_vector.data());
+    }
+    
+    // Invalidate query-side caches
+    ++generation;
+    
     // Persist immediately to disk (only this document's data)
-    std::string delta_dir = "./data";
-    persist_to_disk(doc_id, term_ids, new_term_ids);
+    persist_to_disk(doc_id, term_ids, new_term_ids, semantic ? doc_vector.data() : nullptr);
     
     std::cout << "[Stage 9] Document " << doc_id << " indexed and persisted (" 
               << term_ids.size() << " terms, " << unique_terms.size() << " unique)\n";
@@ -115,7 +136,8 @@ std::vector<std::string> DynamicIndexer::tokenize(const std::string& text) {
 }
 
 // Private overload: persist single document's data
-void DynamicIndexer::persist_to_disk(int doc_id, const std::vector<int>& term_ids, const std::unordered_set<int>& new_term_ids) {
+void DynamicIndexer::persist_to_disk(int doc_id, const std::vector<int>& term_ids, const std::unordered_set<int>& new_term_ids,
+                                     const float* doc_vector) {
     std::string delta_dir = "./data";
     
     // Create delta directory if it doesn't exist
@@ -126,6 +148,7 @@ void DynamicIndexer::persist_to_disk(int doc_id, const std::vector<int>& term_id
     std::string inverted_file = delta_dir + "/delta_inverted_index.dat";
     std::string lexicon_file = delta_dir + "/delta_lexicon.dat";
     std::string stats_file = delta_dir + "/delta_stats.dat";
+    std::string vectors_file = delta_dir + "/delta_doc_vectors.dat";
     
     // Save forward index delta (this document only)
     save_forward_delta(forward_file, doc_id, term_ids);
@@ -145,6 +168,11 @@ void DynamicIndexer::persist_to_disk(int doc_id, const std::vector<int>& term_id
         }
     }
     
+    // Save semantic vector delta
+    if (doc_vector) {
+        save_vector_delta(vectors_file, doc_id, doc_vector);
+    }
+    
     // Save stats
     save_stats(stats_file);
 }
@@ -192,6 +220,18 @@ void DynamicIndexer::save_lexicon_delta(const std::string& filepath, const std::
     out.close();
 }
 
+void DynamicIndexer::save_vector_delta(const std::string& filepath, int doc_id, const float* vec) {
+    std::ofstream out(filepath, std::ios::app | std::ios::binary);
+    if (!out.is_open()) return;
+    
+    // Format: doc_id (int) | stride (int) | unit-length vector (float[stride])
+    int stride = static_cast<int>(semantic->vector_stride());
+    out.write(reinterpret_cast<const char*>(&doc_id), sizeof(int));
+    out.write(reinterpret_cast<const char*>(&stride), sizeof(int));
+    out.write(reinterpret_cast<const char*>(vec), stride * sizeof(float));
+    out.close();
+}
+
 void DynamicIndexer::save_stats(const std::string& filepath) {
     std::ofstream out(filepath);
     if (!out.is_open()) return;
@@ -208,6 +248,7 @@ int DynamicIndexer::load_delta_index(const std::string& delta_dir) {
     std::string inverted_file = delta_dir + "/delta_inverted_index.dat";
     std::string lexicon_file = delta_dir + "/delta_lexicon.dat";
     std::string stats_file = delta_dir + "/delta_stats.dat";
+    std::string vectors_file = delta_dir + "/delta_doc_vectors.dat";
     
     // Load stats first to get next_doc_id
     if (fs::exists(stats_file)) {
@@ -220,6 +261,7 @@ int DynamicIndexer::load_delta_index(const std::string& delta_dir) {
     if (fs::exists(lexicon_file)) {
         load_lexicon_delta(lexicon_file);
         std::cout << "[Stage 9] Loaded lexicon delta\n";
+        if (semantic) semantic->add_new_terms();
     }
     
     // Load forward index delta
@@ -235,9 +277,29 @@ int DynamicIndexer::load_delta_index(const std::string& delta_dir) {
         std::cout << "[Stage 9] Loaded inverted index delta\n";
     }
     
+    // Load semantic vector delta; documents without a stored vector are embedded from their terms
+    if (semantic && loaded_count > 0) {
+        int stored = fs::exists(vectors_file) ? load_vector_delta(vectors_file) : 0;
+        int embedded = 0;
+        const auto& docs = forward_index.getIndex();
+        for (int doc_id = static_cast<int>(semantic->num_documents()); doc_id < next_doc_id; ++doc_id) {
+            auto it = docs.find(doc_id);
+            if (it == docs.end()) continue;
+            AlignedFloatVector vec = semantic->embed_terms(it->second);
+            if (semantic->add_document_vector(doc_id, vec.data())) {
+                save_vector_delta(vectors_file, doc_id, vec.data());
+                ++embedded;
+            }
+        }
+        std::cout << "[Stage 9] Loaded " << stored << " semantic vectors from delta";
+        if (embedded > 0) std::cout << " (" << embedded << " re-embedded)";
+        std::cout << "\n";
+    }
+    
     // Update ranking stats after loading
     if (loaded_count > 0) {
         ranking.update_stats();
+        ++generation;
         std::cout << "[Stage 9] Updated ranking statistics\n";
     }
     
@@ -269,6 +331,37 @@ void DynamicIndexer::load_forward_delta(const std::string& filepath) {
     in.close();
 }
 
+int DynamicIndexer::load_vector_delta(const std::string& filepath) {
+    std::ifstream in(filepath, std::ios::binary);
+    if (!in.is_open()) return 0;
+    
+    int loaded = 0;
+    std::vector<float> buffer;
+    AlignedFloatVector vec(semantic->vector_stride());
+    while (in.good()) {
+        int doc_id;
+        int stride;
+        
+        in.read(reinterpret_cast<char*>(&doc_id), sizeof(int));
+        if (!in.good()) break;
+        
+        in.read(reinterpret_cast<char*>(&stride), sizeof(int));
+        if (!in.good() || stride <= 0) break;
+        
+        buffer.resize(stride);
+        in.read(reinterpret_cast<char*>(buffer.data()), stride * sizeof(float));
+        if (!in.good()) break;
+        
+        // Written with another embedding dimension: skip (re-embedded from terms by the caller)
+        if (static_cast<size_t>(stride) != vec.size()) continue;
+        std::copy(buffer.begin(), buffer.end(), vec.begin());
+        if (semantic->add_document_vector(doc_id, vec.data())) ++loaded;
+    }
+    
+    in.close();
+    return loaded;
+}
+
 void DynamicIndexer::load_inverted_delta(const std::string& filepath) {
     std::ifstream in(filepath, std::ios::binary);
     if (!in.is_open()) return;
@@ -367,6 +460,7 @@ int DynamicIndexer::compact_delta_to_static() {
     // Step 4: Update ranking stats
     std::cout << "[COMPACT] Updating ranking statistics...\n";
     ranking.update_stats();
+    ++generation;
     
     // Step 5: Clear delta files on disk
     std::string delta_dir = "./data";
@@ -374,12 +468,14 @@ int DynamicIndexer::compact_delta_to_static() {
     std::string inverted_file = delta_dir + "/delta_inverted_index.dat";
     std::string lexicon_file = delta_dir + "/delta_lexicon.dat";
     std::string stats_file = delta_dir + "/delta_stats.dat";
+    std::string vectors_file = delta_dir + "/delta_doc_vectors.dat";
     
     std::cout << "[COMPACT] Clearing delta files...\n";
     std::remove(forward_file.c_str());
     std::remove(inverted_file.c_str());
     std::remove(lexicon_file.c_str());
     std::remove(stats_file.c_str());
+    std::remove(vectors_file.c_str());
     
     // Step 6: Save updated stats (with cleared delta)
     save_stats(stats_file);
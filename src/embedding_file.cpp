@@ -0,0 +1,176 @@
+#include "embedding_file.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static const char EMBEDDING_MAGIC[4] = {'E', 'M', 'B', '1'};
+static const uint32_t EMBEDDING_VERSION = 1;
+
+// Size and modification time of the source text (staleness key)
+static bool source_stat(const std::string& path, uint64_t& size, int64_t& mtime) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0) return false;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+#endif
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+template <typename T>
+static void write_pod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void pad_to(std::ostream& out, uint64_t alignment) {
+    while (static_cast<uint64_t>(out.tellp()) % alignment != 0) out.put('\0');
+}
+
+bool EmbeddingFile::convert(const std::string& glove_file, const std::string& cache_file, int dim) {
+    std::ifstream in(glove_file);
+    if (!in) return false;
+
+    EmbeddingFileHeader hdr = {};
+    std::memcpy(hdr.magic, EMBEDDING_MAGIC, sizeof(hdr.magic));
+    hdr.version = EMBEDDING_VERSION;
+    hdr.dim = static_cast<uint32_t>(dim);
+    if (!source_stat(glove_file, hdr.source_size, hdr.source_mtime)) return false;
+
+    std::string tmp_file = cache_file + ".tmp";
+    std::ofstream out(tmp_file, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    // Header is rewritten at the end once all offsets are known
+    write_pod(out, hdr);
+    pad_to(out, 64);
+    hdr.matrix_offset = static_cast<uint64_t>(out.tellp());
+
+    // Stream matrix rows straight to disk; only the words are kept in memory
+    std::vector<std::string> words;
+    std::vector<float> row(dim);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t space = line.find(' ');
+        if (space == std::string::npos) continue;
+
+        std::fill(row.begin(), row.end(), 0.0f);
+        const char* cursor = line.c_str() + space;
+        for (int i = 0; i < dim; ++i) {
+            char* end = nullptr;
+            row[i] = std::strtof(cursor, &end);
+            if (end == cursor) break;
+            cursor = end;
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), dim * sizeof(float));
+        words.push_back(line.substr(0, space));
+    }
+    hdr.num_words = words.size();
+
+    // Word bytes in row order, then the index sorted by word
+    hdr.words_offset = static_cast<uint64_t>(out.tellp());
+    std::vector<WordRef> refs(words.size());
+    uint64_t offset = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        out.write(words[i].data(), words[i].size());
+        refs[i] = {offset, static_cast<uint32_t>(words[i].size()), static_cast<uint32_t>(i)};
+        offset += words[i].size();
+    }
+    std::sort(refs.begin(), refs.end(), [&words](const WordRef& a, const WordRef& b) {
+        return words[a.row] < words[b.row];
+    });
+
+    pad_to(out, alignof(WordRef));
+    hdr.index_offset = static_cast<uint64_t>(out.tellp());
+    out.write(reinterpret_cast<const char*>(refs.data()), refs.size() * sizeof(WordRef));
+
+    out.seekp(0);
+    write_pod(out, hdr);
+    out.close();
+    if (!out) {
+        std::remove(tmp_file.c_str());
+        return false;
+    }
+
+    // Replace any stale cache (rename cannot overwrite on Windows)
+    std::remove(cache_file.c_str());
+    if (std::rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+        std::remove(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool EmbeddingFile::open(const std::string& cache_file, const std::string& glove_file, int dim) {
+    header = nullptr;
+    if (!map.open(cache_file) || map.size() < sizeof(EmbeddingFileHeader)) {
+        map.close();
+        return false;
+    }
+
+    const auto* hdr = reinterpret_cast<const EmbeddingFileHeader*>(map.data());
+    size_t size = map.size();
+    bool valid = std::memcmp(hdr->magic, EMBEDDING_MAGIC, sizeof(hdr->magic)) == 0 &&
+                 hdr->version == EMBEDDING_VERSION &&
+                 hdr->dim == static_cast<uint32_t>(dim) &&
+                 hdr->num_words <= size / sizeof(WordRef) && // bounds the products below
+                 hdr->matrix_offset % alignof(float) == 0 &&
+                 hdr->matrix_offset + hdr->num_words * hdr->dim * sizeof(float) <= size &&
+                 hdr->words_offset <= hdr->index_offset &&
+                 hdr->index_offset % alignof(WordRef) == 0 &&
+                 hdr->index_offset + hdr->num_words * sizeof(WordRef) <= size;
+
+    // find() trusts every ref: each must name bytes inside the words section and a matrix row
+    if (valid) {
+        const auto* refs = reinterpret_cast<const WordRef*>(map.data() + hdr->index_offset);
+        uint64_t words_size = hdr->index_offset - hdr->words_offset;
+        for (uint64_t i = 0; i < hdr->num_words && valid; ++i) {
+            valid = refs[i].offset <= words_size && refs[i].length <= words_size - refs[i].offset &&
+                    refs[i].row < hdr->num_words;
+        }
+    }
+
+    // Stale if the source text changed since conversion
+    uint64_t source_size;
+    int64_t source_mtime;
+    if (valid && source_stat(glove_file, source_size, source_mtime)) {
+        valid = source_size == hdr->source_size && source_mtime == hdr->source_mtime;
+    }
+    if (!valid) {
+        map.close();
+        return false;
+    }
+
+    header = hdr;
+    matrix = reinterpret_cast<const float*>(map.data() + hdr->matrix_offset);
+    words = map.data() + hdr->words_offset;
+    index = reinterpret_cast<const WordRef*>(map.data() + hdr->index_offset);
+    map.advise(MappedFile::Access::Random);
+    return true;
+}
+
+const float* EmbeddingFile::find(const std::string& word) const {
+    if (!header) return nullptr;
+
+    const WordRef* begin = index;
+    const WordRef* end = index + header->num_words;
+    auto compare = [this](const WordRef& ref, const std::string& key) {
+        // Lexicographic compare of the mapped bytes against key (std::string ordering)
+        size_t n = std::min<size_t>(ref.length, key.size());
+        int c = std::memcmp(words + ref.offset, key.data(), n);
+        return c != 0 ? c < 0 : ref.length < key.size();
+    };
+    const WordRef* it = std::lower_bound(begin, end, word, compare);
+    if (it == end || it->length != word.size() || std::memcmp(words + it->offset, word.data(), word.size()) != 0) {
+        return nullptr;
+    }
+    return matrix + static_cast<size_t>(it->row) * header->dim;
+}
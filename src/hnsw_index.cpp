@@ -0,0 +1,393 @@
+#include "hnsw_index.h"
+#include "thread_pool.h"
+#include "vector_kernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <queue>
+
+static const char HNSW_MAGIC[4] = {'H', 'N', 'S', 'W'};
+static const uint32_t HNSW_VERSION = 1;
+
+struct HnswFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t m;
+    uint32_t ef_construction;
+    uint64_t num_nodes;
+    uint64_t stride;
+    uint64_t fingerprint;
+    int32_t max_level;
+    uint32_t entry_point;
+};
+static_assert(sizeof(HnswFileHeader) == 48, "HnswFileHeader must be packed to 48 bytes");
+
+// Epoch-tagged visited marks, one per thread, reused across searches
+struct VisitedSet {
+    std::vector<uint32_t> marks;
+    uint32_t epoch = 0;
+
+    void reset(size_t n) {
+        if (marks.size() < n) marks.resize(n, 0);
+        if (++epoch == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    // True the first time id is seen since reset()
+    bool visit(uint32_t id) {
+        if (marks[id] == epoch) return false;
+        marks[id] = epoch;
+        return true;
+    }
+};
+
+static VisitedSet& thread_visited() {
+    static thread_local VisitedSet visited;
+    return visited;
+}
+
+HnswIndex::HnswIndex(const AlignedFloatVector& vecs, size_t row_stride, const HnswParams& p)
+    : vectors(vecs), stride(row_stride), params(p)
+{
+    params.m = std::max(params.m, 2);
+    params.ef_construction = std::max(params.ef_construction, params.m);
+    max_m0 = 2 * params.m;
+    level_mult = 1.0 / std::log(static_cast<double>(params.m));
+}
+
+float HnswIndex::distance(const float* a, uint32_t id) const {
+    return 1.0f - dot_product(a, row(id), stride);
+}
+
+int HnswIndex::random_level() {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double r = uniform(rng);
+    if (r <= 0.0) r = 1e-12;
+    return static_cast<int>(-std::log(r) * level_mult);
+}
+
+void HnswIndex::allocate_node(uint32_t id, int level) {
+    levels[id] = level;
+    if (level > 0) upper_links[id].assign(static_cast<size_t>(level) * (params.m + 1), 0);
+}
+
+uint32_t* HnswIndex::link_list(uint32_t id, int level) {
+    if (level == 0) return &links0[static_cast<size_t>(id) * (max_m0 + 1)];
+    return &upper_links[id][static_cast<size_t>(level - 1) * (params.m + 1)];
+}
+
+const uint32_t* HnswIndex::link_list(uint32_t id, int level) const {
+    if (level == 0) return &links0[static_cast<size_t>(id) * (max_m0 + 1)];
+    return &upper_links[id][static_cast<size_t>(level - 1) * (params.m + 1)];
+}
+
+void HnswIndex::copy_links(uint32_t id, int level, std::vector<uint32_t>& out) const {
+    std::lock_guard<std::mutex> lock(lock_for(id));
+    const uint32_t* list = link_list(id, level);
+    out.assign(list + 1, list + 1 + list[0]);
+}
+
+void HnswIndex::build(size_t num_vectors, size_t num_threads) {
+    levels.assign(num_vectors, 0);
+    links0.assign(num_vectors * (max_m0 + 1), 0);
+    upper_links.assign(num_vectors, {});
+    num_nodes = num_vectors;
+    entry_point = 0;
+    max_level = -1;
+    if (num_vectors == 0) return;
+
+    // Levels are drawn up front so the build is reproducible regardless of thread interleaving
+    for (size_t i = 0; i < num_vectors; ++i) allocate_node(static_cast<uint32_t>(i), random_level());
+
+    insert(0);
+    std::atomic<size_t> next{1};
+    auto worker = [this, &next, num_vectors]() {
+        size_t id;
+        while ((id = next.fetch_add(1)) < num_vectors) insert(static_cast<uint32_t>(id));
+    };
+
+    num_threads = std::max<size_t>(1, std::min(num_threads, num_vectors));
+    if (num_threads == 1) {
+        worker();
+        return;
+    }
+    ThreadPool pool(num_threads);
+    std::vector<std::future<void>> done;
+    for (size_t t = 0; t < num_threads; ++t) done.push_back(pool.submit(worker));
+    for (auto& f : done) f.get();
+}
+
+void HnswIndex::add(uint32_t id) {
+    if (id < num_nodes) return; // already indexed
+    size_t new_size = static_cast<size_t>(id) + 1;
+    levels.resize(new_size, 0);
+    links0.resize(new_size * (max_m0 + 1), 0);
+    upper_links.resize(new_size);
+    num_nodes = new_size;
+    allocate_node(id, random_level());
+    insert(id);
+}
+
+void HnswIndex::insert(uint32_t id) {
+    int level = levels[id];
+    const float* query = row(id);
+
+    // The global lock is held for the whole insert only when this node becomes the new top
+    std::unique_lock<std::mutex> top(graph_mutex);
+    if (max_level < 0) {
+        entry_point = id;
+        max_level = level;
+        return;
+    }
+    uint32_t ep = entry_point;
+    int top_level = max_level;
+    if (level <= top_level) top.unlock();
+
+    for (int l = top_level; l > level; --l) ep = greedy_closest(query, ep, l);
+
+    for (int l = std::min(level, top_level); l >= 0; --l) {
+        std::vector<Candidate> candidates = search_layer(query, ep, params.ef_construction, l);
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [id](const Candidate& c) { return c.second == id; }),
+                         candidates.end());
+        if (candidates.empty()) continue;
+        std::vector<Candidate> neighbors = select_neighbors(candidates, params.m);
+
+        {
+            std::lock_guard<std::mutex> lock(lock_for(id));
+            uint32_t* list = link_list(id, l);
+            list[0] = static_cast<uint32_t>(neighbors.size());
+            for (size_t i = 0; i < neighbors.size(); ++i) list[1 + i] = neighbors[i].second;
+        }
+        for (const auto& nb : neighbors) connect(nb.second, id, l);
+        ep = candidates.front().second;
+    }
+
+    if (level > top_level) {
+        entry_point = id;
+        max_level = level;
+    }
+}
+
+uint32_t HnswIndex::greedy_closest(const float* query, uint32_t ep, int level) const {
+    float best = distance(query, ep);
+    std::vector<uint32_t> neighbors;
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        copy_links(ep, level, neighbors);
+        for (uint32_t nb : neighbors) {
+            float d = distance(query, nb);
+            if (d < best) {
+                best = d;
+                ep = nb;
+                improved = true;
+            }
+        }
+    }
+    return ep;
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::search_layer(const float* query, uint32_t ep, size_t ef, int level) const {
+    VisitedSet& visited = thread_visited();
+    visited.reset(num_nodes);
+
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> frontier; // closest on top
+    std::priority_queue<Candidate> best;                                                       // farthest on top
+
+    float d = distance(query, ep);
+    visited.visit(ep);
+    frontier.push({d, ep});
+    best.push({d, ep});
+
+    std::vector<uint32_t> neighbors;
+    while (!frontier.empty()) {
+        Candidate current = frontier.top();
+        if (current.first > best.top().first && best.size() >= ef) break;
+        frontier.pop();
+
+        copy_links(current.second, level, neighbors);
+        for (uint32_t nb : neighbors) {
+            if (!visited.visit(nb)) continue;
+            float dn = distance(query, nb);
+            if (best.size() < ef || dn < best.top().first) {
+                frontier.push({dn, nb});
+                best.push({dn, nb});
+                if (best.size() > ef) best.pop();
+            }
+        }
+    }
+
+    std::vector<Candidate> result(best.size());
+    for (size_t i = result.size(); i-- > 0;) {
+        result[i] = best.top();
+        best.pop();
+    }
+    return result;
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::select_neighbors(const std::vector<Candidate>& sorted, size_t max_count) const {
+    // Heuristic from the paper: keep a candidate only if it is closer to the
+    // base than to every neighbor already kept, which preserves links across clusters
+    std::vector<Candidate> selected;
+    for (const auto& c : sorted) {
+        if (selected.size() >= max_count) break;
+        const float* cv = row(c.second);
+        bool keep = true;
+        for (const auto& s : selected) {
+            if (distance(cv, s.second) < c.first) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) selected.push_back(c);
+    }
+    return selected;
+}
+
+void HnswIndex::connect(uint32_t from, uint32_t to, int level) {
+    std::lock_guard<std::mutex> lock(lock_for(from));
+    uint32_t* list = link_list(from, level);
+    size_t count = list[0];
+    size_t capacity = max_links(level);
+    if (count < capacity) {
+        list[1 + count] = to;
+        list[0] = static_cast<uint32_t>(count + 1);
+        return;
+    }
+
+    // Full: re-select among the existing links plus the new one
+    const float* base = row(from);
+    std::vector<Candidate> candidates;
+    candidates.reserve(count + 1);
+    candidates.push_back({distance(base, to), to});
+    for (size_t i = 0; i < count; ++i) candidates.push_back({distance(base, list[1 + i]), list[1 + i]});
+    std::sort(candidates.begin(), candidates.end());
+
+    std::vector<Candidate> kept = select_neighbors(candidates, capacity);
+    list[0] = static_cast<uint32_t>(kept.size());
+    for (size_t i = 0; i < kept.size(); ++i) list[1 + i] = kept[i].second;
+}
+
+std::vector<std::pair<int, float>> HnswIndex::search(const float* query, size_t k, int ef) const {
+    std::vector<std::pair<int, float>> results;
+    uint32_t ep;
+    int top_level;
+    {
+        std::lock_guard<std::mutex> lock(graph_mutex);
+        if (max_level < 0 || k == 0) return results;
+        ep = entry_point;
+        top_level = max_level;
+    }
+
+    for (int l = top_level; l > 0; --l) ep = greedy_closest(query, ep, l);
+    size_t ef_size = std::max<size_t>(k, ef > 0 ? ef : params.ef_search);
+    std::vector<Candidate> candidates = search_layer(query, ep, ef_size, 0);
+
+    size_t keep = std::min(k, candidates.size());
+    results.reserve(keep);
+    for (size_t i = 0; i < keep; ++i) {
+        results.push_back({static_cast<int>(candidates[i].second), 1.0f - candidates[i].first});
+    }
+    return results;
+}
+
+bool HnswIndex::save(const std::string& path) const {
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        HnswFileHeader hdr = {};
+        std::memcpy(hdr.magic, HNSW_MAGIC, sizeof(hdr.magic));
+        hdr.version = HNSW_VERSION;
+        hdr.m = static_cast<uint32_t>(params.m);
+        hdr.ef_construction = static_cast<uint32_t>(params.ef_construction);
+        hdr.num_nodes = num_nodes;
+        hdr.stride = stride;
+        hdr.fingerprint = matrix_fingerprint(vectors.data(), num_nodes, stride);
+        hdr.max_level = max_level;
+        hdr.entry_point = entry_point;
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+        out.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(int));
+        out.write(reinterpret_cast<const char*>(links0.data()), links0.size() * sizeof(uint32_t));
+        for (const auto& upper : upper_links) {
+            out.write(reinterpret_cast<const char*>(upper.data()), upper.size() * sizeof(uint32_t));
+        }
+        if (!out) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool HnswIndex::load(const std::string& path, size_t num_vectors) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    HnswFileHeader hdr;
+    if (!in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr))) return false;
+    if (std::memcmp(hdr.magic, HNSW_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != HNSW_VERSION) return false;
+    if (hdr.m != static_cast<uint32_t>(params.m) ||
+        hdr.ef_construction != static_cast<uint32_t>(params.ef_construction) ||
+        hdr.num_nodes != num_vectors || hdr.stride != stride ||
+        hdr.fingerprint != matrix_fingerprint(vectors.data(), num_vectors, stride)) {
+        return false; // built with other parameters or over other vectors
+    }
+    if (num_vectors > 0 && (hdr.max_level < 0 || hdr.entry_point >= num_vectors)) return false;
+
+    std::vector<int> file_levels(num_vectors);
+    std::vector<uint32_t> file_links0(num_vectors * (max_m0 + 1));
+    in.read(reinterpret_cast<char*>(file_levels.data()), file_levels.size() * sizeof(int));
+    in.read(reinterpret_cast<char*>(file_links0.data()), file_links0.size() * sizeof(uint32_t));
+    std::vector<std::vector<uint32_t>> file_upper(num_vectors);
+    for (size_t i = 0; i < num_vectors && in; ++i) {
+        if (file_levels[i] < 0 || file_levels[i] > hdr.max_level) return false;
+        file_upper[i].resize(static_cast<size_t>(file_levels[i]) * (params.m + 1));
+        in.read(reinterpret_cast<char*>(file_upper[i].data()), file_upper[i].size() * sizeof(uint32_t));
+    }
+    if (!in) return false;
+
+    // Reject corrupt link lists rather than crash on them later
+    auto valid_list = [num_vectors](const uint32_t* list, size_t capacity) {
+        if (list[0] > capacity) return false;
+        for (uint32_t i = 0; i < list[0]; ++i) {
+            if (list[1 + i] >= num_vectors) return false;
+        }
+        return true;
+    };
+    for (size_t i = 0; i < num_vectors; ++i) {
+        if (!valid_list(&file_links0[i * (max_m0 + 1)], max_m0)) return false;
+        for (size_t off = 0; off < file_upper[i].size(); off += params.m + 1) {
+            if (!valid_list(&file_upper[i][off], params.m)) return false;
+        }
+    }
+
+    levels = std::move(file_levels);
+    links0 = std::move(file_links0);
+    upper_links = std::move(file_upper);
+    num_nodes = num_vectors;
+    max_level = num_vectors > 0 ? hdr.max_level : -1;
+    entry_point = hdr.entry_point;
+    return true;
+}
+
+size_t HnswIndex::memory_bytes() const {
+    size_t bytes = levels.capacity() * sizeof(int) + links0.capacity() * sizeof(uint32_t);
+    for (const auto& upper : upper_links) bytes += sizeof(upper) + upper.capacity() * sizeof(uint32_t);
+    return bytes;
+}
@@ -0,0 +1,379 @@
+#include "ivfpq_index.h"
+#include "thread_pool.h"
+#include "vector_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <random>
+
+static const char IVFPQ_MAGIC[4] = {'I', 'V', 'P', 'Q'};
+static const uint32_t IVFPQ_VERSION = 1;
+
+struct IvfPqFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t stride;
+    uint32_t num_subquantizers;
+    uint32_t nlist;
+    uint32_t ksub;
+    uint64_t num_vectors;
+    uint64_t fingerprint;
+};
+static_assert(sizeof(IvfPqFileHeader) == 40, "IvfPqFileHeader must be packed to 40 bytes");
+
+// Short vectors (PQ subspaces) are cheaper with an inlined loop than a dispatched kernel call
+static inline float dot(const float* a, const float* b, size_t dim) {
+    if (dim >= 16) return dot_product(a, b, dim);
+    float sum = 0.0f;
+    for (size_t i = 0; i < dim; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+static float squared_distance(const float* a, const float* b, size_t dim) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+// Lloyd's k-means over n points of `dim` floats spaced `stride` apart; returns k x dim centroids
+static std::vector<float> kmeans(const float* data, size_t n, size_t dim, size_t stride, size_t k,
+                                 int iterations, std::mt19937_64& rng, ThreadPool& pool)
+{
+    std::vector<float> centroids(k * dim, 0.0f);
+    if (n == 0 || k == 0) return centroids;
+
+    // Initialize from k distinct random points
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+    for (size_t c = 0; c < k; ++c) {
+        std::copy(data + order[c % n] * stride, data + order[c % n] * stride + dim, &centroids[c * dim]);
+    }
+
+    std::vector<uint32_t> assignment(n);
+    std::vector<float> norms(k);
+    for (int iter = 0; iter < iterations; ++iter) {
+        for (size_t c = 0; c < k; ++c) norms[c] = dot(&centroids[c * dim], &centroids[c * dim], dim);
+
+        // Assign: argmin ||x - c||^2 = argmin ||c||^2 - 2 x.c
+        pool.parallel_for(n, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const float* x = data + i * stride;
+                float best = std::numeric_limits<float>::max();
+                uint32_t best_c = 0;
+                for (size_t c = 0; c < k; ++c) {
+                    float d = norms[c] - 2.0f * dot(x, &centroids[c * dim], dim);
+                    if (d < best) {
+                        best = d;
+                        best_c = static_cast<uint32_t>(c);
+                    }
+                }
+                assignment[i] = best_c;
+            }
+        });
+
+        // Update: mean of each cluster; empty clusters restart from a random point
+        std::vector<double> sums(k * dim, 0.0);
+        std::vector<size_t> counts(k, 0);
+        for (size_t i = 0; i < n; ++i) {
+            const float* x = data + i * stride;
+            double* sum = &sums[assignment[i] * dim];
+            for (size_t d = 0; d < dim; ++d) sum[d] += x[d];
+            ++counts[assignment[i]];
+        }
+        for (size_t c = 0; c < k; ++c) {
+            float* centroid = &centroids[c * dim];
+            if (counts[c] == 0) {
+                const float* x = data + (rng() % n) * stride;
+                std::copy(x, x + dim, centroid);
+                continue;
+            }
+            for (size_t d = 0; d < dim; ++d) centroid[d] = static_cast<float>(sums[c * dim + d] / counts[c]);
+        }
+    }
+    return centroids;
+}
+
+IvfPqIndex::IvfPqIndex(size_t row_stride, const IvfPqParams& p)
+    : stride(row_stride), params(p)
+{
+    // Subspaces must tile the vector exactly
+    int nsub = std::max(1, std::min(params.num_subquantizers, static_cast<int>(stride)));
+    while (stride % nsub != 0) --nsub;
+    params.num_subquantizers = nsub;
+    params.nprobe = std::max(1, params.nprobe);
+    dsub = stride / nsub;
+}
+
+size_t IvfPqIndex::nearest_centroid(const float* vec) const {
+    size_t nlist = centroid_norms.size();
+    float best = std::numeric_limits<float>::max();
+    size_t best_c = 0;
+    for (size_t c = 0; c < nlist; ++c) {
+        float d = centroid_norms[c] - 2.0f * dot_product(vec, &centroids[c * stride], stride);
+        if (d < best) {
+            best = d;
+            best_c = c;
+        }
+    }
+    return best_c;
+}
+
+void IvfPqIndex::encode_residual(const float* residual, uint8_t* code) const {
+    for (int s = 0; s < params.num_subquantizers; ++s) {
+        const float* sub = residual + s * dsub;
+        const float* book = &codebooks[static_cast<size_t>(s) * KSUB * dsub];
+        float best = std::numeric_limits<float>::max();
+        size_t best_k = 0;
+        for (size_t k = 0; k < KSUB; ++k) {
+            float d = squared_distance(sub, book + k * dsub, dsub);
+            if (d < best) {
+                best = d;
+                best_k = k;
+            }
+        }
+        code[s] = static_cast<uint8_t>(best_k);
+    }
+}
+
+void IvfPqIndex::train_and_add(const float* vectors, size_t n, size_t num_threads) {
+    std::mt19937_64 rng(0x49565051);
+    ThreadPool pool(num_threads);
+
+    size_t nlist = params.nlist > 0 ? static_cast<size_t>(params.nlist)
+                                    : static_cast<size_t>(4.0 * std::sqrt(static_cast<double>(n)));
+    nlist = std::max<size_t>(1, std::min(nlist, std::max<size_t>(n, 1)));
+    params.nlist = static_cast<int>(nlist);
+
+    // Training sample in random order (copied so it is contiguous): the PQ codebooks use a
+    // prefix of it, which must not be the first documents of the corpus
+    std::vector<size_t> sample(n);
+    std::iota(sample.begin(), sample.end(), 0);
+    std::shuffle(sample.begin(), sample.end(), rng);
+    if (n > params.max_train_points) sample.resize(params.max_train_points);
+    size_t n_train = sample.size();
+    std::vector<float> train(n_train * stride);
+    for (size_t i = 0; i < n_train; ++i) {
+        std::copy(vectors + sample[i] * stride, vectors + (sample[i] + 1) * stride, &train[i * stride]);
+    }
+
+    // Coarse quantizer
+    centroids = kmeans(train.data(), n_train, stride, stride, nlist, params.train_iterations, rng, pool);
+    centroid_norms.resize(nlist);
+    for (size_t c = 0; c < nlist; ++c) centroid_norms[c] = dot_product(&centroids[c * stride], &centroids[c * stride], stride);
+
+    // PQ codebooks on the training residuals, one k-means per subspace
+    pool.parallel_for(n_train, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            float* x = &train[i * stride];
+            const float* c = &centroids[nearest_centroid(x) * stride];
+            for (size_t d = 0; d < stride; ++d) x[d] -= c[d];
+        }
+    });
+    // 64 points per codeword is plenty for the codebooks (a random subset, the sample is shuffled)
+    size_t n_pq = std::min(n_train, KSUB * 64);
+    size_t nsub = params.num_subquantizers;
+    codebooks.assign(nsub * KSUB * dsub, 0.0f); // unused codewords (tiny corpora) stay at zero
+    for (size_t s = 0; s < nsub; ++s) {
+        size_t ksub = std::min(KSUB, n_pq);
+        std::vector<float> book = kmeans(train.data() + s * dsub, n_pq, dsub, stride, ksub,
+                                         params.train_iterations, rng, pool);
+        std::copy(book.begin(), book.end(), &codebooks[s * KSUB * dsub]);
+    }
+
+    // Encode everything: assignment and codes in parallel, list appends in order
+    list_ids.assign(nlist, {});
+    list_codes.assign(nlist, {});
+    num_vectors = 0;
+    std::vector<uint32_t> cells(n);
+    std::vector<uint8_t> codes(n * nsub);
+    pool.parallel_for(n, [&](size_t begin, size_t end) {
+        std::vector<float> residual(stride);
+        for (size_t i = begin; i < end; ++i) {
+            const float* x = vectors + i * stride;
+            size_t cell = nearest_centroid(x);
+            const float* c = &centroids[cell * stride];
+            for (size_t d = 0; d < stride; ++d) residual[d] = x[d] - c[d];
+            encode_residual(residual.data(), &codes[i * nsub]);
+            cells[i] = static_cast<uint32_t>(cell);
+        }
+    });
+    for (size_t i = 0; i < n; ++i) {
+        list_ids[cells[i]].push_back(static_cast<uint32_t>(i));
+        list_codes[cells[i]].insert(list_codes[cells[i]].end(), &codes[i * nsub], &codes[(i + 1) * nsub]);
+    }
+    num_vectors = n;
+}
+
+void IvfPqIndex::add(uint32_t id, const float* vec) {
+    if (centroids.empty()) return; // not trained
+    size_t cell = nearest_centroid(vec);
+    const float* c = &centroids[cell * stride];
+    std::vector<float> residual(stride);
+    for (size_t d = 0; d < stride; ++d) residual[d] = vec[d] - c[d];
+
+    std::vector<uint8_t> code(params.num_subquantizers);
+    encode_residual(residual.data(), code.data());
+    list_ids[cell].push_back(id);
+    list_codes[cell].insert(list_codes[cell].end(), code.begin(), code.end());
+    num_vectors = std::max(num_vectors, static_cast<size_t>(id) + 1);
+}
+
+std::vector<std::pair<int, float>> IvfPqIndex::search(const float* query, size_t k, int nprobe) const {
+    std::vector<std::pair<int, float>> results;
+    size_t nlist = centroid_norms.size();
+    if (nlist == 0 || k == 0) return results;
+
+    // Nearest cells by L2 (the same rule used to assign vectors)
+    std::vector<float> qc(nlist);
+    dot_product_batch(query, centroids.data(), stride, nlist, stride, qc.data());
+    std::vector<uint32_t> cells(nlist);
+    std::iota(cells.begin(), cells.end(), 0);
+    size_t probe = std::min(nlist, static_cast<size_t>(nprobe > 0 ? nprobe : params.nprobe));
+    std::partial_sort(cells.begin(), cells.begin() + probe, cells.end(), [&](uint32_t a, uint32_t b) {
+        return centroid_norms[a] - 2.0f * qc[a] < centroid_norms[b] - 2.0f * qc[b];
+    });
+
+    // ADC table: q_s . codeword for every subspace and code
+    size_t nsub = params.num_subquantizers;
+    std::vector<float> table(nsub * KSUB);
+    for (size_t s = 0; s < nsub; ++s) {
+        const float* q = query + s * dsub;
+        for (size_t c = 0; c < KSUB; ++c) {
+            table[s * KSUB + c] = dot(q, &codebooks[(s * KSUB + c) * dsub], dsub);
+        }
+    }
+
+    using Scored = std::pair<float, uint32_t>;
+    std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> top; // worst kept on top
+    for (size_t p = 0; p < probe; ++p) {
+        uint32_t cell = cells[p];
+        float base = qc[cell];
+        const auto& ids = list_ids[cell];
+        const uint8_t* code = list_codes[cell].data();
+        for (size_t i = 0; i < ids.size(); ++i, code += nsub) {
+            float score = base;
+            for (size_t s = 0; s < nsub; ++s) score += table[s * KSUB + code[s]];
+            if (top.size() < k) {
+                top.push({score, ids[i]});
+            } else if (score > top.top().first) {
+                top.pop();
+                top.push({score, ids[i]});
+            }
+        }
+    }
+
+    results.resize(top.size());
+    for (size_t i = results.size(); i-- > 0;) {
+        results[i] = {static_cast<int>(top.top().second), top.top().first};
+        top.pop();
+    }
+    return results;
+}
+
+bool IvfPqIndex::save(const std::string& path, uint64_t fingerprint) const {
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        IvfPqFileHeader hdr = {};
+        std::memcpy(hdr.magic, IVFPQ_MAGIC, sizeof(hdr.magic));
+        hdr.version = IVFPQ_VERSION;
+        hdr.stride = static_cast<uint32_t>(stride);
+        hdr.num_subquantizers = static_cast<uint32_t>(params.num_subquantizers);
+        hdr.nlist = static_cast<uint32_t>(centroid_norms.size());
+        hdr.ksub = static_cast<uint32_t>(KSUB);
+        hdr.num_vectors = num_vectors;
+        hdr.fingerprint = fingerprint;
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+        out.write(reinterpret_cast<const char*>(centroids.data()), centroids.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(codebooks.data()), codebooks.size() * sizeof(float));
+        for (size_t c = 0; c < list_ids.size(); ++c) {
+            uint64_t count = list_ids[c].size();
+            out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            out.write(reinterpret_cast<const char*>(list_ids[c].data()), count * sizeof(uint32_t));
+            out.write(reinterpret_cast<const char*>(list_codes[c].data()), list_codes[c].size());
+        }
+        if (!out) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool IvfPqIndex::load(const std::string& path, size_t expected_vectors, uint64_t fingerprint) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    IvfPqFileHeader hdr;
+    if (!in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr))) return false;
+    if (std::memcmp(hdr.magic, IVFPQ_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != IVFPQ_VERSION) return false;
+    if (hdr.stride != stride || hdr.ksub != KSUB ||
+        hdr.num_subquantizers != static_cast<uint32_t>(params.num_subquantizers) ||
+        (params.nlist > 0 && hdr.nlist != static_cast<uint32_t>(params.nlist)) ||
+        hdr.nlist == 0 || hdr.num_vectors != expected_vectors || hdr.fingerprint != fingerprint) {
+        return false; // built with other parameters or over other vectors
+    }
+
+    size_t nlist = hdr.nlist;
+    size_t nsub = hdr.num_subquantizers;
+    std::vector<float> file_centroids(nlist * stride);
+    std::vector<float> file_codebooks(nsub * KSUB * dsub);
+    in.read(reinterpret_cast<char*>(file_centroids.data()), file_centroids.size() * sizeof(float));
+    in.read(reinterpret_cast<char*>(file_codebooks.data()), file_codebooks.size() * sizeof(float));
+
+    std::vector<std::vector<uint32_t>> file_ids(nlist);
+    std::vector<std::vector<uint8_t>> file_codes(nlist);
+    size_t total = 0;
+    for (size_t c = 0; c < nlist && in; ++c) {
+        uint64_t count = 0;
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (!in || count > hdr.num_vectors) return false;
+        file_ids[c].resize(count);
+        file_codes[c].resize(count * nsub);
+        in.read(reinterpret_cast<char*>(file_ids[c].data()), count * sizeof(uint32_t));
+        in.read(reinterpret_cast<char*>(file_codes[c].data()), count * nsub);
+        for (uint32_t id : file_ids[c]) {
+            if (id >= hdr.num_vectors) return false;
+        }
+        total += count;
+    }
+    if (!in || total > hdr.num_vectors) return false;
+
+    centroids = std::move(file_centroids);
+    codebooks = std::move(file_codebooks);
+    list_ids = std::move(file_ids);
+    list_codes = std::move(file_codes);
+    centroid_norms.resize(nlist);
+    for (size_t c = 0; c < nlist; ++c) centroid_norms[c] = dot_product(&centroids[c * stride], &centroids[c * stride], stride);
+    params.nlist = static_cast<int>(nlist);
+    num_vectors = hdr.num_vectors;
+    return true;
+}
+
+size_t IvfPqIndex::memory_bytes() const {
+    size_t bytes = (centroids.capacity() + centroid_norms.capacity() + codebooks.capacity()) * sizeof(float);
+    for (size_t c = 0; c < list_ids.size(); ++c) {
+        bytes += list_ids[c].capacity() * sizeof(uint32_t) + list_codes[c].capacity();
+        bytes += sizeof(list_ids[c]) + sizeof(list_codes[c]);
+    }
+    return bytes;
+}
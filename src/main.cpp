@@ -6,7 +6,11 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <random>
 #include <cctype>
+#include <climits>
+#include <stdexcept>
+#include <type_traits>
 
 #include "stage1_lexicon.h"
 #include "stage2_forward_index.h"
@@ -17,6 +21,13 @@
 #include "stage7_semantic.h"
 #include "stage8_autocomplete.h"
 #include "dynamic_indexer.h"
+#include "query_cache.h"
+#include "tiered_index.h"
+#include "vector_kernels.h"
+#include "hnsw_index.h"
+#include "ivfpq_index.h"
+#include "term_expansion.h"
+#include "thread_pool.h"
 
 // Helper: Trim whitespace from string
 std::string trim(const std::string& str) {
@@ -68,7 +79,203 @@ void semantic_debug(
     std::cout << "[END SEMANTIC DEBUG]\n\n";
 }
 
-int main() {
+// ANN evaluation: recall@k and latency of the ANN index against brute force,
+// using randomly sampled document vectors as queries
+void evaluate_ann(std::shared_ptr<SemanticEngine> semantic, const std::string& ann_mode, size_t num_queries, int k) {
+    using Clock = std::chrono::high_resolution_clock;
+    size_t stride = semantic->vector_stride();
+    AlignedFloatVector query_rows(num_queries * stride);
+    std::vector<const float*> queries;
+    std::mt19937 rng(42);
+    size_t num_docs = semantic->num_documents();
+    for (size_t attempts = 0; queries.size() < num_queries && attempts < num_queries * 10 && num_docs > 0; ++attempts) {
+        float* vec = &query_rows[queries.size() * stride];
+        semantic->document_vector(static_cast<int>(rng() % num_docs), vec);
+        if (!semantic->search_vector(vec, 1, true).empty()) queries.push_back(vec); // skip zero vectors
+    }
+    if (queries.empty()) {
+        std::cout << "[EVAL] No documents with embeddings to query." << std::endl;
+        return;
+    }
+
+    // Ground truth
+    std::vector<std::vector<int>> truth;
+    auto start = Clock::now();
+    for (const float* q : queries) {
+        std::vector<int> ids;
+        for (const auto& r : semantic->search_vector(q, k, true)) ids.push_back(r.doc_id);
+        truth.push_back(ids);
+    }
+    double exact_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries.size();
+    std::cout << "[EVAL] " << queries.size() << " queries, k=" << k << ", " << num_docs << " documents" << std::endl;
+    std::cout << "[EVAL] brute force: " << exact_us << " us/query" << std::endl;
+
+    // Sweep efSearch (HNSW) or nprobe (IVF-PQ)
+    bool ivf = ann_mode == "ivfpq";
+    std::vector<int> widths = ivf ? std::vector<int>{1, 2, 4, 8, 16, 32, 64}
+                                  : std::vector<int>{16, 32, 64, 128, 256, 512};
+    for (int width : widths) {
+        if (!ivf && width < k) continue;
+        size_t found = 0, expected = 0;
+        start = Clock::now();
+        std::vector<std::vector<SearchResult>> approx;
+        for (const float* q : queries) approx.push_back(semantic->search_vector(q, k, false, width));
+        double ann_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries.size();
+
+        for (size_t i = 0; i < queries.size(); ++i) {
+            expected += truth[i].size();
+            for (const auto& r : approx[i]) {
+                if (std::find(truth[i].begin(), truth[i].end(), r.doc_id) != truth[i].end()) ++found;
+            }
+        }
+        double recall = expected ? static_cast<double>(found) / expected : 1.0;
+        std::cout << "[EVAL] " << (ivf ? "nprobe=" : "ef_search=") << width << ": recall@" << k << "=" << recall
+                  << " | " << ann_us << " us/query | speedup " << (ann_us > 0 ? exact_us / ann_us : 0.0) << "x" << std::endl;
+    }
+}
+
+static void print_usage() {
+    std::cerr << "Usage: search_engine [--build-barrels [N] [dir]] [--ram-budget-mb <MB>]"
+              << " [--ann hnsw|ivfpq|none] [--hnsw-m N] [--hnsw-ef-construction N] [--hnsw-ef-search N]"
+              << " [--ivf-nlist N] [--ivf-nprobe N] [--pq-m N]"
+              << " [--eval-ann [queries] [k]] [--vector-storage f32|f16|int8]"
+              << " [--cascade-n1 N] [--cascade-n2 N] [--build-expansions [K]] [--expand N] [--expand-weight W]"
+              << " [--hybrid rrf|weighted|none] [--hybrid-depth N] [--hybrid-weight W]"
+              << " [--fuzzy-edits N] [--fuzzy-budget-us US]" << std::endl;
+}
+
+// Parse the whole of `text` as a number in [min_value, max_value]; on failure print the usage and return false
+template <typename T>
+static bool parse_number(const std::string& flag, const std::string& text, T min_value, T max_value, T& out) {
+    long double value = 0;
+    size_t used = 0;
+    try {
+        if constexpr (std::is_floating_point<T>::value) value = std::stold(text, &used);
+        else value = static_cast<long double>(std::stoll(text, &used));
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || value < static_cast<long double>(min_value) ||
+        value > static_cast<long double>(max_value)) {
+        std::cerr << "[ERROR] Invalid value for " << flag << ": " << text << " (expected " << min_value << " to "
+                  << max_value << ")" << std::endl;
+        print_usage();
+        return false;
+    }
+    out = static_cast<T>(value);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // Command-line modes:
+    //   (no arguments)                  interactive CLI
+    //   --build-barrels [N] [dir]       write N Stage 6 barrels (default 8, ./data/barrels) and exit
+    //   --ram-budget-mb <MB>            hot-tier postings budget when serving from barrels (default 256)
+    //   --ann <hnsw|ivfpq|none>         approximate index for semantic search (default hnsw)
+    //   --hnsw-m / --hnsw-ef-construction / --hnsw-ef-search <N>   HNSW parameters (16 / 200 / 64)
+    //   --ivf-nlist / --ivf-nprobe / --pq-m <N>                    IVF-PQ parameters (auto / 8 / 16)
+    //   --eval-ann [queries] [k]        measure ANN recall@k and latency against brute force and exit
+    //   --vector-storage <f32|f16|int8> document vector format for rerank (default f32)
+    //   --cascade-n1 / --cascade-n2 <N> candidates kept for semantic rerank / BM25 rescoring (1000 / 0 = off)
+    //   --build-expansions [K]          precompute the K nearest terms of every lexicon term (default 10) and exit
+    //   --expand <N> / --expand-weight <W>   synonyms added per query term (3, 0 = off) / their weight (0.5)
+    //   --hybrid <rrf|weighted|none>    fuse lexical and ANN results instead of reranking (default none)
+    //   --hybrid-depth <N> / --hybrid-weight <W>   results taken from each list (100) / lexical weight (0.5)
+    //   --fuzzy-edits <N> / --fuzzy-budget-us <US> typos tolerated by FUZZY: (1, at most 2) / its time limit (2000)
+    bool build_barrels = false;
+    int num_barrels = 8;
+    std::string barrels_dir = "./data/barrels";
+    size_t ram_budget_mb = 256;
+    std::string ann_mode = "hnsw";
+    HnswParams hnsw_params;
+    IvfPqParams ivfpq_params;
+    VectorStorage vector_storage = VectorStorage::Float32;
+    bool eval_ann = false;
+    bool build_expansions = false;
+    int expansion_k = 10;
+    size_t eval_queries = 200;
+    int eval_k = 10;
+    int fuzzy_edits = 1;
+    int fuzzy_budget_us = 2000;
+    SearchOptions search_options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--build-barrels") {
+            build_barrels = true;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])) &&
+                !parse_number(arg, argv[++i], 1, 4096, num_barrels)) return 1;
+            if (i + 1 < argc && argv[i + 1][0] != '-') barrels_dir = argv[++i];
+        } else if (arg == "--ram-budget-mb" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], size_t(0), size_t(1) << 20, ram_budget_mb)) return 1;
+        } else if (arg == "--ann" && i + 1 < argc) {
+            ann_mode = argv[++i];
+            if (ann_mode != "hnsw" && ann_mode != "ivfpq" && ann_mode != "none") {
+                std::cerr << "[ERROR] Unknown ANN index: " << ann_mode << " (expected hnsw, ivfpq or none)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--hnsw-m" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 2, 256, hnsw_params.m)) return 1;
+        } else if (arg == "--hnsw-ef-construction" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 1, 100000, hnsw_params.ef_construction)) return 1;
+        } else if (arg == "--hnsw-ef-search" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 1, 100000, hnsw_params.ef_search)) return 1;
+        } else if (arg == "--ivf-nlist" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 0, 1 << 24, ivfpq_params.nlist)) return 1; // 0: auto
+        } else if (arg == "--ivf-nprobe" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 1, 1 << 24, ivfpq_params.nprobe)) return 1;
+        } else if (arg == "--pq-m" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 1, 256, ivfpq_params.num_subquantizers)) return 1;
+        } else if (arg == "--vector-storage" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "f16") vector_storage = VectorStorage::Float16;
+            else if (format == "int8") vector_storage = VectorStorage::Int8;
+            else if (format == "f32") vector_storage = VectorStorage::Float32;
+            else {
+                std::cerr << "[ERROR] Unknown vector storage: " << format << " (expected f32, f16 or int8)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--cascade-n1" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 1, INT_MAX, search_options.first_phase_depth)) return 1;
+        } else if (arg == "--cascade-n2" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 0, INT_MAX, search_options.rescore_depth)) return 1; // 0: off
+        } else if (arg == "--build-expansions") {
+            build_expansions = true;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])) &&
+                !parse_number(arg, argv[++i], 1, 1000, expansion_k)) return 1;
+        } else if (arg == "--expand" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 0, 1000, search_options.expansion_terms)) return 1; // 0: off
+        } else if (arg == "--expand-weight" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 0.0f, 1.0f, search_options.expansion_weight)) return 1;
+        } else if (arg == "--hybrid" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "rrf") search_options.fusion = HybridFusion::ReciprocalRank;
+            else if (mode == "weighted") search_options.fusion = HybridFusion::WeightedScore;
+            else if (mode == "none") search_options.fusion = HybridFusion::None;
+            else {
+                std::cerr << "[ERROR] Unknown hybrid fusion: " << mode << " (expected rrf, weighted or none)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--hybrid-depth" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 1, INT_MAX, search_options.fusion_depth)) return 1;
+        } else if (arg == "--hybrid-weight" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 0.0f, 1.0f, search_options.lexical_weight)) return 1;
+        } else if (arg == "--fuzzy-edits" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 0, Autocomplete::MAX_FUZZY_EDITS, fuzzy_edits)) return 1;
+        } else if (arg == "--fuzzy-budget-us" && i + 1 < argc) {
+            if (!parse_number(arg, argv[++i], 1, INT_MAX, fuzzy_budget_us)) return 1;
+        } else if (arg == "--eval-ann") {
+            eval_ann = true;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])) &&
+                !parse_number(arg, argv[++i], size_t(1), size_t(1000000), eval_queries)) return 1;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])) &&
+                !parse_number(arg, argv[++i], 1, 1000, eval_k)) return 1;
+        } else {
+            std::cerr << "[ERROR] Unknown argument: " << arg << std::endl;
+            print_usage();
+            return 1;
+        }
+    }
+    
     std::cout << "========================================" << std::endl;
     std::cout << "   Search Engine - Industry Grade CLI" << std::endl;
     std::cout << "   Stages 1-9 Implementation" << std::endl;
@@ -107,11 +314,57 @@ int main() {
     fwd_index.build_from_docs(documents, lex);
     std::cout << "[Stage 2] Total documents: " << fwd_index.getIndex().size() << std::endl;
     
+    // Barrels are only valid for the corpus and lexicon numbering they were written from
+    CorpusIdentity corpus = CorpusIdentity::of(lex, fwd_index);
+    std::string manifest_path = BarrelsWriter::manifest_path(barrels_dir);
+    std::shared_ptr<BarrelsReader> barrels;
+    size_t stale_barrels = 0; // barrel count of a manifest that must be rewritten
+    if (!build_barrels && std::ifstream(manifest_path).good()) {
+        barrels = std::make_shared<BarrelsReader>(manifest_path);
+        // Stale barrels would serve other documents' postings under these IDs: rewrite them
+        if (barrels->is_loaded() && barrels->corpus() != corpus) {
+            const CorpusIdentity& stale = barrels->corpus();
+            std::cout << "[Stage 6] Barrels were built from a different corpus (" << stale.num_documents << " docs, "
+                      << stale.lexicon_terms << " terms; now " << corpus.num_documents << " docs, "
+                      << corpus.lexicon_terms << " terms). Rebuilding..." << std::endl;
+            stale_barrels = barrels->num_barrels();
+            barrels.reset(); // unmap before overwriting
+        } else if (!barrels->is_loaded()) {
+            // Unreadable, or its barrels come from different builds (interrupted COMPACT)
+            std::cout << "[Stage 6] Barrel manifest could not be loaded. Rebuilding " << num_barrels
+                      << " barrels..." << std::endl;
+            stale_barrels = static_cast<size_t>(num_barrels);
+            barrels.reset();
+        }
+    }
+    
     // Stage 3: Inverted Index
-    std::cout << "[Stage 3] Building Inverted Index..." << std::endl;
+    // Valid barrels already hold the static postings, so the in-memory index is
+    // only built when there are none (or they have to be rewritten from it)
     InvertedIndex inv_index;
-    inv_index.build(fwd_index);
-    std::cout << "[Stage 3] Inverted terms: " << inv_index.getIndex().size() << std::endl;
+    if (!barrels || !barrels->is_loaded()) {
+        std::cout << "[Stage 3] Building Inverted Index..." << std::endl;
+        inv_index.build(fwd_index);
+        std::cout << "[Stage 3] Inverted terms: " << inv_index.getIndex().size() << std::endl;
+    } else {
+        std::cout << "[Stage 3] Static postings served from barrels; in-memory inverted index not built." << std::endl;
+    }
+    
+    // Build mode: partition the inverted index into barrels and exit
+    if (build_barrels) {
+        std::cout << "[Stage 6] Writing " << num_barrels << " barrels to " << barrels_dir << "..." << std::endl;
+        auto start = std::chrono::high_resolution_clock::now();
+        BarrelsWriter writer(num_barrels);
+        if (!writer.write(inv_index, corpus, barrels_dir)) {
+            std::cerr << "[ERROR] Barrel build failed." << std::endl;
+            return 1;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "[Stage 6] Barrels written in " << ms << " ms: "
+                  << BarrelsWriter::manifest_path(barrels_dir) << std::endl;
+        return 0;
+    }
     
     // Stage 4: Ranking
     std::cout << "[Stage 4] Computing Ranking Statistics..." << std::endl;
@@ -119,24 +372,105 @@ int main() {
     std::cout << "[Stage 4] Avg document length updated: " << ranker.get_avg_doc_len() << std::endl;
     
     // Stage 5: Query Engine
+    // (the static index is only consulted when no barrels are loaded)
     std::cout << "[Stage 5] Initializing Query Engine..." << std::endl;
     QueryEngine qengine(lex, inv_index);
     qengine.attach_forward_index(fwd_index);
+    qengine.attach_ranking(ranker);
+    qengine.set_default_options(search_options);
+    auto query_cache = std::make_shared<QueryCache>(16 * 1024 * 1024); // 16 MB result cache
+    qengine.use_cache(query_cache);
     std::cout << "[Stage 5] Query Engine initialized." << std::endl;
     
     // Stage 6: Barrels
     std::cout << "[Stage 6] Initializing Barrels Reader..." << std::endl;
-    std::shared_ptr<BarrelsReader> barrels = std::make_shared<BarrelsReader>();
+    if (stale_barrels > 0) {
+        BarrelsWriter writer(static_cast<int>(stale_barrels));
+        if (writer.write(inv_index, corpus, barrels_dir)) {
+            barrels = std::make_shared<BarrelsReader>(manifest_path);
+            std::cout << "[Stage 6] Barrels rebuilt (" << barrels->num_terms() << " terms)." << std::endl;
+        } else {
+            std::cerr << "[Stage 6] Barrel rebuild failed; serving from in-memory index." << std::endl;
+        }
+    } else if (barrels) {
+        std::cout << "[Stage 6] Loaded barrel manifest (" << barrels->num_terms() << " terms)." << std::endl;
+    } else {
+        std::cout << "[Stage 6] No barrels found (run with --build-barrels to create them)." << std::endl;
+    }
+    if (!barrels) barrels = std::make_shared<BarrelsReader>();
     qengine.use_barrels(barrels);
+    
+    // Tiered serving: hot postings stay in RAM, the long tail is read from barrels.
+    // The hot tier is then the only resident copy of the static postings.
+    std::shared_ptr<TieredPostingsStore> tiered;
+    if (barrels->is_loaded()) {
+        inv_index.release();
+        tiered = std::make_shared<TieredPostingsStore>(barrels, ram_budget_mb * 1024 * 1024);
+        tiered->warm_from_df(lex);
+        qengine.use_tiered(tiered);
+        TieredStats tstats = tiered->get_stats();
+        std::cout << "[Stage 6] Tiered mode: " << tstats.hot_terms << " hot terms resident ("
+                  << tstats.hot_bytes / 1024 << " KB of " << ram_budget_mb << " MB budget)." << std::endl;
+    }
     std::cout << "[Stage 6] Barrels ready." << std::endl;
     
     // Stage 7: Semantic Engine
     std::cout << "[Stage 7] Loading Semantic Engine..." << std::endl;
     std::string glove_path = "./data/glove.6B.50d.txt";
-    auto semantic = std::make_shared<SemanticEngine>(glove_path, 50);
-    semantic->build_document_vectors(documents, lex, ranker);
+    auto semantic = std::make_shared<SemanticEngine>(glove_path, 50, lex);
+    std::cout << "[Stage 7] Embeddings kept for " << semantic->num_embedded_terms() << " lexicon terms ("
+              << semantic->embedding_memory_bytes() / 1024 << " KB)." << std::endl;
+    
+    // Offline job: nearest-term table for query expansion
+    std::string expansions_path = "./data/term_expansions.bin";
+    if (build_expansions) {
+        std::cout << "[Stage 7] Computing " << expansion_k << " nearest terms for " << semantic->num_embedded_terms()
+                  << " terms..." << std::endl;
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!semantic->build_expansion_table(expansions_path, expansion_k, ThreadPool::default_threads())) {
+            std::cerr << "[ERROR] Expansion table build failed." << std::endl;
+            return 1;
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "[Stage 7] Expansion table written in " << ms << " ms: " << expansions_path << std::endl;
+        return 0;
+    }
+    auto expansions = std::make_shared<TermExpansionTable>();
+    if (expansions->open(expansions_path, semantic->embedding_fingerprint())) {
+        qengine.use_expansions(expansions);
+        std::cout << "[Stage 7] Query expansion table loaded (" << expansions->num_terms() << " terms, "
+                  << expansions->k() << " neighbors each)." << std::endl;
+    } else if (std::ifstream(expansions_path).good()) {
+        std::cout << "[Stage 7] Ignoring stale expansion table " << expansions_path
+                  << " (rebuild with --build-expansions)." << std::endl;
+    }
+    
+    semantic->set_vector_storage(vector_storage);
+    auto vec_start = std::chrono::high_resolution_clock::now();
+    semantic->build_document_vectors(fwd_index, documents.size(), ThreadPool::default_threads());
+    auto vec_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - vec_start).count();
+    std::cout << "[Stage 7] Document vectors built in " << vec_ms << " ms." << std::endl;
+    if (ann_mode == "ivfpq") {
+        semantic->build_ivfpq_index(ivfpq_params, "./data/ivfpq_index.bin", ThreadPool::default_threads());
+        std::cout << "[Stage 7] IVF-PQ index: nprobe=" << ivfpq_params.nprobe << ", " << ivfpq_params.num_subquantizers
+                  << "-byte codes (" << semantic->ann_memory_bytes() / 1024 << " KB)." << std::endl;
+    } else if (ann_mode == "hnsw" || eval_ann) {
+        semantic->build_ann_index(hnsw_params, "./data/hnsw_index.bin", ThreadPool::default_threads());
+        std::cout << "[Stage 7] HNSW index: M=" << hnsw_params.m << ", efConstruction=" << hnsw_params.ef_construction
+                  << ", efSearch=" << hnsw_params.ef_search << " (" << semantic->ann_memory_bytes() / 1024 << " KB)." << std::endl;
+    }
+    if (eval_ann) {
+        evaluate_ann(semantic, ann_mode == "ivfpq" ? "ivfpq" : "hnsw", eval_queries, eval_k);
+        return 0;
+    }
+    // Quantized formats keep only the compact copy unless the HNSW graph needs the float rows
+    semantic->release_float_vectors();
+    std::cout << "[Stage 7] Document vectors: " << semantic->num_documents() << " ("
+              << semantic->document_memory_bytes() / 1024 << " KB)." << std::endl;
     qengine.use_semantic(semantic);
-    std::cout << "[Stage 7] Semantic Engine ready." << std::endl;
+    std::cout << "[Stage 7] Semantic Engine ready (similarity kernel: " << vector_kernel_name() << ")." << std::endl;
     
     // Stage 8: Autocomplete
     std::cout << "[Stage 8] Building Autocomplete Trie..." << std::endl;
@@ -147,6 +481,8 @@ int main() {
     // Stage 9: Dynamic Indexer
     std::cout << "[Stage 9] Initializing Dynamic Indexer..." << std::endl;
     DynamicIndexer dynamic_indexer(lex, fwd_index, inv_index, ranker);
+    dynamic_indexer.use_semantic(semantic);
+    dynamic_indexer.use_autocomplete(&autocomplete);
     
     // Load delta index if present
     int delta_docs = dynamic_indexer.load_delta_index("./data");
@@ -160,9 +496,13 @@ int main() {
     qengine.attach_delta_index(&dynamic_indexer.get_delta_inverted_index());
     std::cout << "[Stage 9] Delta index attached to QueryEngine (query-time merge enabled)." << std::endl;
     
+    // Result cache is invalidated by the dynamic indexer's generation counter
+    qengine.attach_index_generation(dynamic_indexer.generation_counter());
+    
     // Rebuild autocomplete from lexicon (to include any loaded delta terms)
     autocomplete.rebuild_from_lexicon();
-    std::cout << "[Stage 8] Autocomplete rebuilt from lexicon (includes delta terms)." << std::endl;
+    std::cout << "[Stage 8] Autocomplete rebuilt from lexicon (includes delta terms): " << autocomplete.num_words()
+              << " words, " << autocomplete.memory_bytes() / 1024 << " KB." << std::endl;
     
     std::cout << "\n[INIT] Initialization complete!\n" << std::endl;
     std::cout << "========================================\n" << std::endl;
@@ -174,8 +514,10 @@ int main() {
     std::cout << "  - Enter query text to search" << std::endl;
     std::cout << "  - ADD: <text> to add new document" << std::endl;
     std::cout << "  - AUTO: <prefix> for autocomplete" << std::endl;
+    std::cout << "  - FUZZY: <prefix> for typo-tolerant autocomplete" << std::endl;
     std::cout << "  - SEMANTIC: <query> for semantic-only search (debug)" << std::endl;
     std::cout << "  - COMPACT to merge delta into static index" << std::endl;
+    std::cout << "  - CACHE to show query cache and storage tier statistics" << std::endl;
     std::cout << "  - EXIT or QUIT to exit\n" << std::endl;
     std::cout << "========================================\n" << std::endl;
     
@@ -208,11 +550,9 @@ int main() {
             std::cout << "[Stage 9] Adding document dynamically..." << std::endl;
             auto start = std::chrono::high_resolution_clock::now();
             
+            // Also appends the semantic vector and refreshes the autocomplete paths of its terms
             dynamic_indexer.add_document(doc_text);
             
-            // Industry standard: Update autocomplete after adding new terms
-            autocomplete.rebuild_from_lexicon();
-            
             auto end = std::chrono::high_resolution_clock::now();
             auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
             std::cout << "[Stage 9] Document persisted to disk in " << ms << " ms." << std::endl;
@@ -225,15 +565,53 @@ int main() {
             std::cout << "[COMPACT] Starting delta compaction (offline job)..." << std::endl;
             auto start = std::chrono::high_resolution_clock::now();
             
-            int compacted = dynamic_indexer.compact_delta_to_static();
+            // Barrels serve the static tier: merge them with the delta postings into a
+            // staged set (streamed term by term, no full in-memory index), then swap it in
+            bool rewrite = barrels->is_loaded() && !dynamic_indexer.get_delta_inverted_index().empty();
+            bool merged = false;
+            size_t barrel_count = barrels->num_barrels();
+            std::string staging_dir = barrels_dir + ".compact";
+            if (rewrite) {
+                BarrelsWriter writer(static_cast<int>(barrel_count));
+                merged = writer.write_merged(*barrels, dynamic_indexer.get_delta_inverted_index(),
+                                             CorpusIdentity::of(lex, fwd_index), staging_dir);
+            }
             
-            // Rebuild inverted index from merged forward index (ensure consistency)
-            // Note: Static index already merged, but we need to rebuild for consistency
-            inv_index.build(fwd_index);
+            int compacted = dynamic_indexer.compact_delta_to_static();
             
             // Reattach delta index (now empty) to QueryEngine
             qengine.attach_delta_index(&dynamic_indexer.get_delta_inverted_index());
             
+            if (rewrite) {
+                // Release the old mappings first (Windows cannot overwrite mapped files);
+                // they lack the compacted documents either way
+                qengine.use_tiered(nullptr);
+                qengine.use_barrels(nullptr);
+                tiered.reset();
+                barrels.reset();
+                if (merged && BarrelsWriter::replace(staging_dir, barrels_dir, static_cast<int>(barrel_count))) {
+                    barrels = std::make_shared<BarrelsReader>(manifest_path);
+                    std::cout << "[COMPACT] Barrels rewritten (" << barrels->num_terms() << " terms)." << std::endl;
+                } else {
+                    barrels = std::make_shared<BarrelsReader>();
+                    std::cerr << "[COMPACT] Barrel rewrite failed; serving from in-memory index." << std::endl;
+                }
+                qengine.use_barrels(barrels);
+            }
+            
+            if (barrels->is_loaded()) {
+                // compact_delta_to_static also merged the delta postings into the static index
+                inv_index.release();
+                if (!tiered) {
+                    tiered = std::make_shared<TieredPostingsStore>(barrels, ram_budget_mb * 1024 * 1024);
+                    tiered->warm_from_df(lex);
+                    qengine.use_tiered(tiered);
+                }
+            } else {
+                // Rebuild inverted index from merged forward index (ensure consistency)
+                inv_index.build(fwd_index);
+            }
+            
             auto end = std::chrono::high_resolution_clock::now();
             auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
             std::cout << "[COMPACT] Compaction completed in " << ms << " ms." << std::endl;
@@ -241,6 +619,27 @@ int main() {
             continue;
         }
         
+        // Handle CACHE command (query result cache statistics)
+        if (upper_input == "CACHE") {
+            QueryCacheStats stats = query_cache->get_stats();
+            std::cout << "[Stage 5] Query cache: " << stats.hits << " hits, " << stats.misses << " misses"
+                      << " (hit rate " << stats.hit_rate() * 100.0 << "%)" << std::endl;
+            std::cout << "[Stage 5] Entries: " << stats.entries << " | Bytes: " << stats.bytes
+                      << " / " << stats.capacity_bytes << " | Evictions: " << stats.evictions
+                      << " | Invalidations: " << stats.invalidations << std::endl;
+            std::cout << "[Stage 7] Query vectors: " << semantic->query_cache_hits() << " hits, "
+                      << semantic->query_cache_misses() << " misses" << std::endl;
+            if (tiered) {
+                TieredStats tstats = tiered->get_stats();
+                std::cout << "[Stage 6] Tiers: " << tstats.hot_hits << " hot / " << tstats.cold_hits << " cold lookups"
+                          << " | Resident: " << tstats.hot_terms << " terms, " << tstats.hot_bytes << " / "
+                          << tstats.budget_bytes << " bytes | Promotions: " << tstats.promotions
+                          << " | Demotions: " << tstats.demotions << std::endl;
+            }
+            std::cout << std::endl;
+            continue;
+        }
+        
         // Handle SEMANTIC debug command (Industry standard: semantic search demonstration)
         if (upper_input.size() > 9 && upper_input.substr(0, 9) == "SEMANTIC:") {
             std::string query = trim(input.substr(9));
@@ -268,11 +667,36 @@ int main() {
             continue;
         }
         
+        // Handle FUZZY autocomplete command
+        if (upper_input.size() > 6 && upper_input.substr(0, 6) == "FUZZY:") {
+            std::string prefix = trim(input.substr(6));
+            if (!prefix.empty()) {
+                std::cout << "[Stage 8] Fuzzy suggestions for \"" << prefix << "\" (up to " << fuzzy_edits
+                          << " edits):" << std::endl;
+                auto start = std::chrono::high_resolution_clock::now();
+                bool truncated = false;
+                auto suggestions = autocomplete.get_fuzzy_suggestions(prefix, 5, fuzzy_edits, fuzzy_budget_us, &truncated);
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+                if (suggestions.empty()) {
+                    std::cout << "  No suggestions found." << std::endl;
+                } else {
+                    for (size_t i = 0; i < suggestions.size(); ++i) {
+                        std::cout << "  " << (i + 1) << ". " << suggestions[i] << std::endl;
+                    }
+                }
+                std::cout << "[Stage 8] " << us << " us" << (truncated ? " (time budget reached, partial results)" : "")
+                          << "\n" << std::endl;
+            }
+            continue;
+        }
+        
         // Handle normal search query
         std::cout << "[Stage 5] Processing query: \"" << input << "\"" << std::endl;
         auto start = std::chrono::high_resolution_clock::now();
         
-        auto results = qengine.search(input, 5);
+        SearchTiming timing;
+        auto results = qengine.search(input, qengine.get_default_options(), &timing);
         
         auto end = std::chrono::high_resolution_clock::now();
         auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
@@ -292,6 +716,23 @@ int main() {
             }
         }
         
+        if (timing.cache_hit) {
+            std::cout << "[Stage 5] Served from result cache." << std::endl;
+        } else if (qengine.get_default_options().fusion != HybridFusion::None) {
+            std::cout << "[Stage 5] Hybrid: lexical " << timing.first_phase << " of " << timing.matched << " ("
+                      << timing.retrieval_us + timing.rescore_us << " us) | ANN " << timing.vector_hits << " ("
+                      << timing.vector_us << " us, parallel) | fusion " << timing.fusion_us << " us" << std::endl;
+        } else {
+            std::cout << "[Stage 5] Cascade: ";
+            if (timing.expansions > 0) std::cout << "+" << timing.expansions << " expansion terms, ";
+            std::cout << timing.matched << " matched -> " << timing.first_phase
+                      << " candidates (" << timing.retrieval_us << " us) -> semantic rerank ("
+                      << timing.semantic_us << " us)";
+            if (timing.rescored > 0) {
+                std::cout << " -> BM25 rescoring of " << timing.rescored << " (" << timing.rescore_us << " us)";
+            }
+            std::cout << std::endl;
+        }
         std::cout << "[Stage 5] Query processed in " << ms << " ms.\n" << std::endl;
     }
     
@@ -0,0 +1,236 @@
+#include "mapped_file.h"
+#include <utility>
+#include <cstdint>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    swap(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        swap(other);
+    }
+    return *this;
+}
+
+void MappedFile::swap(MappedFile& other) noexcept {
+    std::swap(ptr, other.ptr);
+    std::swap(length, other.length);
+    std::swap(opened, other.opened);
+#ifdef _WIN32
+    std::swap(file_handle, other.file_handle);
+    std::swap(mapping_handle, other.mapping_handle);
+#else
+    std::swap(fd, other.fd);
+#endif
+}
+
+RandomAccessFile::RandomAccessFile(RandomAccessFile&& other) noexcept {
+#ifdef _WIN32
+    std::swap(handle, other.handle);
+#else
+    std::swap(fd, other.fd);
+#endif
+}
+
+RandomAccessFile& RandomAccessFile::operator=(RandomAccessFile&& other) noexcept {
+    if (this != &other) {
+        close();
+#ifdef _WIN32
+        std::swap(handle, other.handle);
+#else
+        std::swap(fd, other.fd);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+    file_handle = file;
+    length = static_cast<size_t>(file_size.QuadPart);
+    opened = true;
+    if (length == 0) return true; // Nothing to map
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+    mapping_handle = mapping;
+
+    ptr = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!ptr) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (ptr) UnmapViewOfFile(ptr);
+    if (mapping_handle) CloseHandle(static_cast<HANDLE>(mapping_handle));
+    if (file_handle) CloseHandle(static_cast<HANDLE>(file_handle));
+    ptr = nullptr;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+    length = 0;
+    opened = false;
+}
+
+void MappedFile::advise(Access access) const {
+    // Windows has no per-mapping access hint; FILE_FLAG_RANDOM_ACCESS is set at open
+    (void)access;
+}
+
+void MappedFile::prefetch(size_t offset, size_t len) const {
+#if _WIN32_WINNT >= 0x0602
+    if (!ptr || offset >= length) return;
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<char*>(ptr + offset);
+    range.NumberOfBytes = (len < length - offset) ? len : length - offset;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    (void)offset;
+    (void)len;
+#endif
+}
+
+bool RandomAccessFile::open(const std::string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    handle = file;
+    return true;
+}
+
+void RandomAccessFile::close() {
+    if (handle) CloseHandle(static_cast<HANDLE>(handle));
+    handle = nullptr;
+}
+
+bool RandomAccessFile::is_open() const {
+    return handle != nullptr;
+}
+
+size_t RandomAccessFile::read_at(size_t offset, void* buffer, size_t len) const {
+    size_t total = 0;
+    char* out = static_cast<char*>(buffer);
+    while (total < len) {
+        // The offset travels with the request, not with the handle
+        OVERLAPPED ov = {};
+        uint64_t pos = static_cast<uint64_t>(offset + total);
+        ov.Offset = static_cast<DWORD>(pos & 0xFFFFFFFFULL);
+        ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+        DWORD chunk = static_cast<DWORD>((len - total) > 0x40000000 ? 0x40000000 : (len - total));
+        DWORD got = 0;
+        if (!ReadFile(static_cast<HANDLE>(handle), out + total, chunk, &got, &ov) || got == 0) break;
+        total += got;
+    }
+    return total;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    opened = true;
+    if (length == 0) return true; // mmap rejects empty mappings
+
+    void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close();
+        return false;
+    }
+    ptr = static_cast<const char*>(addr);
+    return true;
+}
+
+void MappedFile::close() {
+    if (ptr) munmap(const_cast<char*>(ptr), length);
+    if (fd >= 0) ::close(fd);
+    ptr = nullptr;
+    fd = -1;
+    length = 0;
+    opened = false;
+}
+
+void MappedFile::advise(Access access) const {
+    if (!ptr) return;
+    int advice = MADV_NORMAL;
+    if (access == Access::Random) advice = MADV_RANDOM;
+    else if (access == Access::Sequential) advice = MADV_SEQUENTIAL;
+    madvise(const_cast<char*>(ptr), length, advice);
+}
+
+void MappedFile::prefetch(size_t offset, size_t len) const {
+    if (!ptr || offset >= length) return;
+    // madvise needs a page-aligned start address
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset & ~(page - 1);
+    size_t end = (len < length - offset) ? offset + len : length;
+    madvise(const_cast<char*>(ptr + start), end - start, MADV_WILLNEED);
+}
+
+bool RandomAccessFile::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    return fd >= 0;
+}
+
+void RandomAccessFile::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+bool RandomAccessFile::is_open() const {
+    return fd >= 0;
+}
+
+size_t RandomAccessFile::read_at(size_t offset, void* buffer, size_t len) const {
+    size_t total = 0;
+    char* out = static_cast<char*>(buffer);
+    while (total < len) {
+        ssize_t got = pread(fd, out + total, len - total, static_cast<off_t>(offset + total));
+        if (got <= 0) break;
+        total += static_cast<size_t>(got);
+    }
+    return total;
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include "query_cache.h"
+#include <iterator>
+
+QueryCache::QueryCache(size_t capacity, double protected_ratio)
+    : capacity_bytes(capacity),
+      protected_capacity(static_cast<size_t>(capacity * protected_ratio))
+{
+    stats.capacity_bytes = capacity_bytes;
+}
+
+// Rough heap footprint of one entry (list node + hash node + payload)
+size_t QueryCache::estimate_bytes(const QueryCacheKey& key, const std::vector<SearchResult>& results) {
+    size_t bytes = sizeof(Entry) + 64; // list node + unordered_map node overhead
+    bytes += 2 * key.term_ids.size() * sizeof(int); // key stored in entry and in index
+    bytes += results.size() * sizeof(SearchResult);
+    for (const auto& res : results) bytes += res.snippet.capacity();
+    return bytes;
+}
+
+void QueryCache::sync_generation(uint64_t generation) {
+    if (generation == current_generation) return;
+    if (!index.empty()) stats.invalidations++;
+    clear();
+    current_generation = generation;
+}
+
+bool QueryCache::lookup(const QueryCacheKey& key, uint64_t generation, std::vector<SearchResult>& out) {
+    sync_generation(generation);
+
+    auto it = index.find(key);
+    if (it == index.end()) {
+        stats.misses++;
+        return false;
+    }
+
+    stats.hits++;
+    promote(it->second);
+    out = it->second->results;
+    return true;
+}
+
+void QueryCache::insert(const QueryCacheKey& key, uint64_t generation, const std::vector<SearchResult>& results) {
+    sync_generation(generation);
+
+    size_t bytes = estimate_bytes(key, results);
+    if (bytes > capacity_bytes) return;
+
+    auto existing = index.find(key);
+    if (existing != index.end()) {
+        // Refresh in place (same generation, so contents should match anyway)
+        Entry& entry = *existing->second;
+        if (entry.segment == Segment::Protected) protected_bytes -= entry.bytes;
+        else probation_bytes -= entry.bytes;
+        entry.results = results;
+        entry.bytes = bytes;
+        if (entry.segment == Segment::Protected) protected_bytes += bytes;
+        else probation_bytes += bytes;
+        promote(existing->second);
+        evict_to_fit();
+        return;
+    }
+
+    probation.push_front(Entry{key, results, bytes, Segment::Probation});
+    index[key] = probation.begin();
+    probation_bytes += bytes;
+    evict_to_fit();
+}
+
+// Probation hit -> protected MRU; protected hit -> protected MRU.
+// Protected overflow is demoted back to probation MRU (SLRU).
+void QueryCache::promote(EntryList::iterator it) {
+    if (it->segment == Segment::Protected) {
+        protected_list.splice(protected_list.begin(), protected_list, it);
+        return;
+    }
+
+    probation_bytes -= it->bytes;
+    protected_bytes += it->bytes;
+    it->segment = Segment::Protected;
+    protected_list.splice(protected_list.begin(), probation, it);
+
+    while (protected_bytes > protected_capacity && protected_list.size() > 1) {
+        auto victim = std::prev(protected_list.end());
+        protected_bytes -= victim->bytes;
+        probation_bytes += victim->bytes;
+        victim->segment = Segment::Probation;
+        probation.splice(probation.begin(), protected_list, victim);
+    }
+}
+
+void QueryCache::evict_to_fit() {
+    while (probation_bytes + protected_bytes > capacity_bytes) {
+        EntryList& victims = !probation.empty() ? probation : protected_list;
+        if (victims.empty()) break;
+
+        auto victim = std::prev(victims.end());
+        if (victim->segment == Segment::Protected) protected_bytes -= victim->bytes;
+        else probation_bytes -= victim->bytes;
+        index.erase(victim->key);
+        victims.erase(victim);
+        stats.evictions++;
+    }
+}
+
+void QueryCache::clear() {
+    probation.clear();
+    protected_list.clear();
+    index.clear();
+    probation_bytes = 0;
+    protected_bytes = 0;
+}
+
+QueryCacheStats QueryCache::get_stats() const {
+    QueryCacheStats s = stats;
+    s.entries = index.size();
+    s.bytes = probation_bytes + protected_bytes;
+    return s;
+}
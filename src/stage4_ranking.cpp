@@ -33,6 +33,26 @@ double Stage4Ranking::score(int term_id, int doc_id) const {
     return idf * tf * (k1 + 1) / (tf + k1 * (1 - b + b * doc_len / avg_doc_len));
 }
 
+double Stage4Ranking::score(const std::unordered_map<int,double>& term_weights, int doc_id) const {
+    const auto& fwd_idx = fwd_index.getIndex();
+    auto it = fwd_idx.find(doc_id);
+    if (it == fwd_idx.end()) return 0.0;
+
+    std::unordered_map<int,int> tf;
+    for (int t : it->second) if (term_weights.count(t)) ++tf[t];
+
+    double k1 = 1.5, b = 0.75;
+    int doc_len = static_cast<int>(it->second.size());
+    double total = 0.0;
+    for (const auto& [term_id, count] : tf) {
+        auto idf = idf_map.find(term_id);
+        if (idf == idf_map.end()) continue;
+        total += term_weights.at(term_id) * idf->second * count * (k1 + 1) /
+                 (count + k1 * (1 - b + b * doc_len / avg_doc_len));
+    }
+    return total;
+}
+
 // Added for Stage 9 compatibility: Update stats after dynamic indexing
 void Stage4Ranking::update_stats() {
     // Recompute average document length
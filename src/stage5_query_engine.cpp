@@ -1,12 +1,83 @@
 #include "stage5_query_engine.h"
 #include "stage7_semantic.h" // include full class
+#include "query_cache.h"
+#include "tiered_index.h"
+#include "thread_pool.h"
+#include "term_expansion.h"
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <sstream>
+#include <unordered_map>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double micros_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Best first; ties by doc ID so every depth cut is deterministic
+bool better_result(const SearchResult& a, const SearchResult& b) {
+    return a.score != b.score ? a.score > b.score : a.doc_id < b.doc_id;
+}
+
+// Keep the best `depth` results, sorted
+void keep_best(std::vector<SearchResult>& results, size_t depth) {
+    if (results.size() > depth) {
+        std::nth_element(results.begin(), results.begin() + depth, results.end(), better_result);
+        results.resize(depth);
+    }
+    std::sort(results.begin(), results.end(), better_result);
+}
+
+// Top `depth` of two result lists merged by the fusion mode (each list best first)
+std::vector<SearchResult> fuse(const std::vector<SearchResult>& lexical, const std::vector<SearchResult>& vector,
+                               const SearchOptions& options, size_t depth) {
+    constexpr double RRF_K = 60.0;
+    std::unordered_map<int, double> fused;
+    auto add_list = [&](const std::vector<SearchResult>& list, double weight) {
+        if (list.empty()) return;
+        double lo = list.back().score;
+        double range = list.front().score - lo;
+        for (size_t rank = 0; rank < list.size(); ++rank) {
+            double contribution;
+            if (options.fusion == HybridFusion::ReciprocalRank) {
+                contribution = 1.0 / (RRF_K + rank + 1);
+            } else {
+                contribution = weight * (range > 0.0 ? (list[rank].score - lo) / range : 1.0);
+            }
+            fused[list[rank].doc_id] += contribution;
+        }
+    };
+    add_list(lexical, options.lexical_weight);
+    add_list(vector, 1.0 - options.lexical_weight);
+
+    std::vector<SearchResult> results;
+    results.reserve(fused.size());
+    for (const auto& [doc_id, score] : fused) results.push_back(SearchResult{doc_id, score, ""});
+    keep_best(results, depth);
+    return results;
+}
+
+} // namespace
+
+QueryEngine::~QueryEngine() = default;
 
 std::vector<SearchResult> QueryEngine::search(const std::string& query, int top_k) {
+    SearchOptions options = default_options;
+    options.top_k = top_k;
+    return search(query, options);
+}
+
+std::vector<SearchResult> QueryEngine::search(const std::string& query, const SearchOptions& options,
+                                              SearchTiming* timing) {
     std::vector<SearchResult> results;
+    SearchTiming local_timing;
+    SearchTiming& stats = timing ? *timing : local_timing;
+    stats = SearchTiming();
 
     // Industry standard: Tokenize query with stopword filtering (same as indexing)
     std::vector<std::string> tokens = Lexicon::tokenize_and_filter(query);
@@ -15,30 +86,171 @@ std::vector<SearchResult> QueryEngine::search(const std::string& query, int top_
         int term_id = lexicon.get_term_id(token);
         if (term_id != -1) query_term_ids.push_back(term_id);
     }
+    if (query_term_ids.empty() || options.top_k <= 0) return results;
+
+    // Result cache: key on the normalized (sorted) term-ID sequence + top_k and depths.
+    // Scoring is order-independent, so "car hire" and "hire car" share an entry.
+    QueryCacheKey key;
+    uint64_t generation = index_generation ? *index_generation : 0;
+    if (cache) {
+        key.term_ids = query_term_ids;
+        std::sort(key.term_ids.begin(), key.term_ids.end());
+        key.top_k = options.top_k;
+        key.first_phase_depth = options.first_phase_depth;
+        key.rescore_depth = options.rescore_depth;
+        key.expansion_terms = expansions ? options.expansion_terms : 0;
+        key.expansion_weight = expansions ? options.expansion_weight : 0.0f;
+        key.fusion = static_cast<int>(options.fusion);
+        key.fusion_depth = options.fusion_depth;
+        key.lexical_weight = options.lexical_weight;
+        if (cache->lookup(key, generation, results)) {
+            stats.cache_hit = true;
+            return results;
+        }
+    }
+
+    if (options.fusion != HybridFusion::None && semantic) {
+        results = execute_hybrid(query_term_ids, options, stats);
+    } else {
+        results = execute(query_term_ids, options, true, stats);
+    }
+
+    if (cache) cache->insert(key, generation, results);
+    return results;
+}
+
+std::vector<SearchResult> QueryEngine::execute_hybrid(const std::vector<int>& query_term_ids,
+                                                      const SearchOptions& options, SearchTiming& timing) {
+    size_t depth = static_cast<size_t>(std::max(options.fusion_depth, options.top_k));
+
+    // Vector side on the worker: embed the query and take the ANN top-k
+    // (brute force when no index was built). Reads only immutable state.
+    if (!vector_worker) vector_worker = std::make_unique<ThreadPool>(1);
+    auto vector_future = vector_worker->submit([this, &query_term_ids, depth, &timing]() {
+        auto start = Clock::now();
+        auto query_vec = semantic->query_embedding(query_term_ids);
+        auto hits = semantic->search_vector(query_vec->data(), static_cast<int>(depth), !semantic->has_ann_index());
+        timing.vector_us = micros_since(start);
+        return hits;
+    });
+
+    // Lexical side here, without the semantic rerank (the vector list carries that signal)
+    SearchOptions lexical_options = options;
+    lexical_options.top_k = static_cast<int>(depth);
+    std::vector<SearchResult> lexical = execute(query_term_ids, lexical_options, false, timing);
+    std::vector<SearchResult> vector = vector_future.get();
+    timing.vector_hits = vector.size();
+
+    auto start = Clock::now();
+    std::vector<SearchResult> results = fuse(lexical, vector, options, static_cast<size_t>(options.top_k));
+    timing.fusion_us = micros_since(start);
+    return results;
+}
+
+std::vector<SearchResult> QueryEngine::execute(const std::vector<int>& query_term_ids, const SearchOptions& options,
+                                               bool semantic_rerank, SearchTiming& timing) {
+    std::vector<SearchResult> results;
+    auto stage_start = Clock::now();
+
+    // Query expansion: precomputed nearest terms, one table lookup per query term.
+    // A synonym shared by several query terms keeps its best weight; query terms themselves are never downweighted.
+    std::vector<int> scored_terms = query_term_ids;
+    std::unordered_map<int, double> synonym_weights;
+    if (expansions && options.expansion_terms > 0) {
+        int limit = std::min(options.expansion_terms, expansions->k());
+        for (int term_id : query_term_ids) {
+            const ExpansionEntry* neighbors = expansions->neighbors(term_id);
+            if (!neighbors) continue;
+            for (int i = 0; i < limit && neighbors[i].term_id >= 0; ++i) {
+                int synonym = neighbors[i].term_id;
+                if (std::find(query_term_ids.begin(), query_term_ids.end(), synonym) != query_term_ids.end()) continue;
+                double weight = options.expansion_weight * neighbors[i].similarity;
+                auto [it, inserted] = synonym_weights.emplace(synonym, weight);
+                if (inserted) scored_terms.push_back(synonym);
+                else it->second = std::max(it->second, weight);
+            }
+        }
+        timing.expansions = synonym_weights.size();
+    }
+    auto term_weight = [&synonym_weights](int term_id) {
+        auto it = synonym_weights.find(term_id);
+        return it == synonym_weights.end() ? 1.0 : it->second;
+    };
 
     // Industry standard: Merge static + delta postings at query time
     std::unordered_map<int, double> doc_scores;
-    for (int term_id : query_term_ids) {
-        // Get postings from static index
-        auto static_it = inv_index.getIndex().find(term_id);
-        if (static_it != inv_index.getIndex().end()) {
-            for (int doc_id : static_it->second) {
-                doc_scores[doc_id] += 1.0; // simple frequency-based scoring
+    if (tiered) {
+        // Hot terms score straight from memory; only the cold tail goes to barrels
+        std::vector<int> cold_terms;
+        for (int term_id : scored_terms) {
+            // Terms absent from every barrel (e.g. delta-only) are rejected by the presence filter
+            if (!tiered->barrels().may_contain(term_id)) continue;
+            PostingsView postings;
+            if (!tiered->lookup_hot(term_id, postings)) {
+                cold_terms.push_back(term_id);
+                continue;
+            }
+            double weight = term_weight(term_id);
+            for (int doc_id : postings) {
+                doc_scores[doc_id] += weight; // simple frequency-based scoring
+            }
+        }
+        if (!cold_terms.empty()) {
+            auto fetch = tiered->barrels().fetch_async(cold_terms);
+            int term_id;
+            PostingsView postings;
+            while (fetch->next(term_id, postings)) {
+                double weight = term_weight(term_id);
+                for (int doc_id : postings) {
+                    doc_scores[doc_id] += weight;
+                }
+            }
+        }
+        tiered->maybe_rebalance();
+    } else if (barrels_reader && barrels_reader->is_loaded()) {
+        // Static postings from barrels: all term fetches are issued up front and
+        // scored in completion order (latency is max-of-terms, not the sum)
+        std::vector<int> present_terms;
+        for (int term_id : scored_terms) {
+            if (barrels_reader->may_contain(term_id)) present_terms.push_back(term_id);
+        }
+        auto fetch = barrels_reader->fetch_async(present_terms);
+        int term_id;
+        PostingsView postings;
+        while (fetch->next(term_id, postings)) {
+            double weight = term_weight(term_id);
+            for (int doc_id : postings) {
+                doc_scores[doc_id] += weight; // simple frequency-based scoring
             }
         }
-        
+    } else {
+        // Get postings from static in-memory index
+        for (int term_id : scored_terms) {
+            auto static_it = inv_index.getIndex().find(term_id);
+            if (static_it != inv_index.getIndex().end()) {
+                double weight = term_weight(term_id);
+                for (int doc_id : static_it->second) {
+                    doc_scores[doc_id] += weight; // simple frequency-based scoring
+                }
+            }
+        }
+    }
+
+    for (int term_id : scored_terms) {
         // Get postings from delta index (Stage 9)
         if (delta_inv_index) {
             auto delta_it = delta_inv_index->find(term_id);
             if (delta_it != delta_inv_index->end()) {
+                double weight = term_weight(term_id);
                 for (int doc_id : delta_it->second) {
-                    doc_scores[doc_id] += 1.0; // same scoring
+                    doc_scores[doc_id] += weight; // same scoring
                 }
             }
         }
     }
 
-    // Convert to vector
+    // Stage 1: cheap lexical score, keep the top N1 (never fewer than top_k)
+    results.reserve(doc_scores.size());
     for (auto& [doc_id, score] : doc_scores) {
         SearchResult res;
         res.doc_id = doc_id;
@@ -46,16 +258,45 @@ std::vector<SearchResult> QueryEngine::search(const std::string& query, int top_
         res.snippet = ""; // could fill from ForwardIndex if desired
         results.push_back(res);
     }
+    timing.matched = results.size();
+    size_t first_phase_depth = static_cast<size_t>(std::max(options.first_phase_depth, options.top_k));
+    if (ranking && results.size() > first_phase_depth) {
+        // Match counts tie on every single-term query, so cutting by count would keep the lowest
+        // doc IDs: choose the N1 by BM25 instead. Survivors keep their match score, so the later
+        // stages rank them exactly as if no cut had happened.
+        std::unordered_map<int, double> weights;
+        for (int term_id : scored_terms) weights[term_id] = term_weight(term_id);
+        for (auto& res : results) res.score = ranking->score(weights, res.doc_id);
+        keep_best(results, first_phase_depth);
+        for (auto& res : results) res.score = doc_scores[res.doc_id];
+        std::sort(results.begin(), results.end(), better_result);
+    } else {
+        keep_best(results, first_phase_depth);
+    }
+    timing.first_phase = results.size();
+    timing.retrieval_us = micros_since(stage_start);
 
-    // Apply semantic reranking if available
-    if (semantic && fwd_index) semantic->rerank(query, results, lexicon, Stage4Ranking(*fwd_index, lexicon));
-
+    // Stage 2: semantic rerank of the N1 candidates.
+    // The query vector comes from the resolved term IDs, so results are a pure function of the cache key.
+    if (semantic && semantic_rerank) {
+        stage_start = Clock::now();
+        semantic->rerank(semantic->query_embedding(query_term_ids)->data(), results);
+        std::sort(results.begin(), results.end(), better_result);
+        timing.semantic_us = micros_since(stage_start);
+    }
 
-    // Sort by score descending
-    std::sort(results.begin(), results.end(), [](const SearchResult& a, const SearchResult& b) {
-        return a.score > b.score;
-    });
+    // Stage 3: full BM25 from the forward index for the best N2 (documents below N2 are dropped)
+    if (ranking && options.rescore_depth > 0) {
+        stage_start = Clock::now();
+        results.resize(std::min(results.size(), static_cast<size_t>(std::max(options.rescore_depth, options.top_k))));
+        for (auto& res : results) {
+            for (int term_id : query_term_ids) res.score += ranking->score(term_id, res.doc_id);
+        }
+        std::sort(results.begin(), results.end(), better_result);
+        timing.rescored = results.size();
+        timing.rescore_us = micros_since(stage_start);
+    }
 
-    if (results.size() > (size_t)top_k) results.resize(top_k);
+    if (results.size() > (size_t)options.top_k) results.resize(options.top_k);
     return results;
-}
\ No newline at end of file
+}
@@ -1,66 +1,564 @@
 #include "stage6_barrels.h"
 #include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <random>
+#include <cstdio>
+#include <cstring>
+#if __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#elif __has_include(<experimental/filesystem>)
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#else
+// Fallback for older compilers - caller must create the output directory
+namespace fs {
+    inline void create_directories(const std::string& path) {}
+    inline void remove(const std::string& path) {}
+}
+#endif
+
+// Binary write helper (little-endian host assumed, like the delta files)
+template <typename T>
+static void write_pod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Directory part of a path ("" if none)
+static std::string parent_dir(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? "" : path.substr(0, pos + 1);
+}
 
 // ---------------------------
-// Open barrel file with LRU
+// TinyLFU frequency sketch
 // ---------------------------
-std::shared_ptr<std::ifstream> BarrelsReader::open_barrel(const std::string& barrel_file) {
-    auto it = file_cache.find(barrel_file);
+FrequencySketch::FrequencySketch(size_t w)
+    : counters(DEPTH * w, 0), width(w), sample_size(10 * w) {}
+
+size_t FrequencySketch::index_of(int key, int row) const {
+    // 64-bit mix (splitmix64) with a per-row seed
+    uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(key)) + 0x9E3779B97F4A7C15ULL * (row + 1);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return row * width + static_cast<size_t>(h % width);
+}
+
+void FrequencySketch::increment(int key) {
+    for (int row = 0; row < DEPTH; ++row) {
+        uint8_t& c = counters[index_of(key, row)];
+        if (c < MAX_COUNT) ++c;
+    }
+    if (++additions >= sample_size) age();
+}
 
-    if (it != file_cache.end()) {
-        // Move to front (most recently used)
-        lru_list.erase(it->second.second);
-        lru_list.push_front(barrel_file);
-        it->second.second = lru_list.begin();
-        return it->second.first;
+int FrequencySketch::estimate(int key) const {
+    int result = MAX_COUNT;
+    for (int row = 0; row < DEPTH; ++row) {
+        result = std::min<int>(result, counters[index_of(key, row)]);
     }
+    return result;
+}
+
+void FrequencySketch::age() {
+    for (auto& c : counters) c >>= 1;
+    additions /= 2;
+}
 
-    // Open new file
-    auto fin = std::make_shared<std::ifstream>(barrel_file, std::ios::binary);
-    if (!fin->is_open()) {
-        std::cerr << "Failed to open barrel file: " << barrel_file << "\n";
+// ---------------------------
+// Decoded postings cache
+// ---------------------------
+PostingsCache::PostingsCache(size_t capacity) : capacity_bytes(capacity) {
+    stats.capacity_bytes = capacity;
+}
+
+size_t PostingsCache::estimate_bytes(const std::vector<int>& postings) {
+    // list node + hash node + shared_ptr control block + payload
+    return sizeof(Entry) + 80 + postings.size() * sizeof(int);
+}
+
+PostingsCache::Postings PostingsCache::get(int term_id) {
+    sketch.increment(term_id);
+
+    auto it = index.find(term_id);
+    if (it == index.end()) {
+        stats.misses++;
         return nullptr;
     }
 
-    // Add to LRU cache
-    lru_list.push_front(barrel_file);
-    file_cache[barrel_file] = {fin, lru_list.begin()};
+    stats.hits++;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->postings;
+}
+
+void PostingsCache::put(int term_id, Postings postings) {
+    if (!postings) return;
+    size_t bytes = estimate_bytes(*postings);
+    if (bytes > capacity_bytes || index.count(term_id)) return;
 
-    if (file_cache.size() > max_cache_size) {
-        // Evict least recently used
-        std::string lru_file = lru_list.back();
-        lru_list.pop_back();
-        file_cache.erase(lru_file);
+    // TinyLFU admission: only displace victims that are colder than the candidate
+    int candidate_freq = sketch.estimate(term_id);
+    size_t reclaimable = 0;
+    for (auto it = lru.rbegin(); it != lru.rend() && used_bytes - reclaimable + bytes > capacity_bytes; ++it) {
+        if (sketch.estimate(it->term_id) >= candidate_freq) {
+            stats.rejections++;
+            return;
+        }
+        reclaimable += it->bytes;
     }
 
-    return fin;
+    while (used_bytes + bytes > capacity_bytes) evict_lru();
+
+    lru.push_front(Entry{term_id, std::move(postings), bytes});
+    index[term_id] = lru.begin();
+    used_bytes += bytes;
+    stats.bytes = used_bytes;
+}
+
+void PostingsCache::evict_lru() {
+    auto victim = std::prev(lru.end());
+    used_bytes -= victim->bytes;
+    index.erase(victim->term_id);
+    lru.erase(victim);
+    stats.evictions++;
+    stats.bytes = used_bytes;
+}
+
+void PostingsCache::set_capacity(size_t bytes) {
+    capacity_bytes = bytes;
+    stats.capacity_bytes = bytes;
+    while (used_bytes > capacity_bytes && !lru.empty()) evict_lru();
+}
+
+// ---------------------------
+// Lock-striped postings cache
+// ---------------------------
+ShardedPostingsCache::ShardedPostingsCache(size_t capacity) {
+    set_capacity(capacity);
+}
+
+PostingsCache::Postings ShardedPostingsCache::get(int term_id) {
+    Shard& shard = shard_for(term_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.cache.get(term_id);
+}
+
+void ShardedPostingsCache::put(int term_id, PostingsCache::Postings postings) {
+    Shard& shard = shard_for(term_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.put(term_id, std::move(postings));
+}
+
+void ShardedPostingsCache::set_capacity(size_t bytes) {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.cache.set_capacity(bytes / NUM_SHARDS);
+    }
+}
+
+PostingsCacheStats ShardedPostingsCache::get_stats() const {
+    PostingsCacheStats total;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        PostingsCacheStats s = shard.cache.get_stats();
+        total.hits += s.hits;
+        total.misses += s.misses;
+        total.rejections += s.rejections;
+        total.evictions += s.evictions;
+        total.bytes += s.bytes;
+        total.capacity_bytes += s.capacity_bytes;
+    }
+    return total;
+}
+
+// ---------------------------
+// Load binary manifest
+// ---------------------------
+void BarrelsReader::load_manifest(const std::string& manifest_file) {
+    if (!manifest_map.open(manifest_file)) {
+        std::cerr << "Cannot open manifest file: " << manifest_file << "\n";
+        return;
+    }
+
+    const char* base = manifest_map.data();
+    size_t size = manifest_map.size();
+    ManifestHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "Invalid barrel manifest: " << manifest_file << "\n";
+        manifest_map.close();
+        return;
+    }
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MANIFEST_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MANIFEST_VERSION ||
+        header.entries_offset % alignof(BarrelEntry) != 0 ||
+        header.entries_offset + static_cast<uint64_t>(header.num_slots) * sizeof(BarrelEntry) > size ||
+        header.filters_offset % alignof(uint64_t) != 0 ||
+        header.filters_offset + static_cast<uint64_t>(header.num_barrels) * filter_words(header.range_width) * sizeof(uint64_t) > size) {
+        std::cerr << "Invalid barrel manifest: " << manifest_file << "\n";
+        manifest_map.close();
+        return;
+    }
+
+    // Barrel names are stored relative to the manifest directory
+    std::string dir = parent_dir(manifest_file);
+    size_t pos = sizeof(header);
+    barrels.resize(header.num_barrels);
+    for (uint32_t i = 0; i < header.num_barrels; ++i) {
+        uint32_t len = 0;
+        if (pos + sizeof(len) > header.entries_offset) break;
+        std::memcpy(&len, base + pos, sizeof(len));
+        pos += sizeof(len);
+        if (pos + len > header.entries_offset) break;
+        barrels[i].path = dir + std::string(base + pos, len);
+        pos += len;
+    }
+
+    // Map every barrel once; page-cache residency replaces an open-file LRU
+    for (auto& barrel : barrels) {
+        char barrel_header[BARREL_HEADER_SIZE] = {};
+        if (barrel.map.open(barrel.path)) {
+            barrel.map.advise(MappedFile::Access::Random);
+            if (barrel.map.size() >= BARREL_HEADER_SIZE) std::memcpy(barrel_header, barrel.map.data(), BARREL_HEADER_SIZE);
+        } else if (barrel.file.open(barrel.path)) {
+            barrel.file.read_at(0, barrel_header, BARREL_HEADER_SIZE);
+        } else {
+            std::cerr << "Failed to open barrel file: " << barrel.path << "\n";
+            continue;
+        }
+        // A barrel from another build would be read at this manifest's offsets
+        uint64_t build_id = 0;
+        std::memcpy(&build_id, barrel_header + sizeof(BARREL_MAGIC), sizeof(build_id));
+        if (std::memcmp(barrel_header, BARREL_MAGIC, sizeof(BARREL_MAGIC)) != 0 || build_id != header.build_id) {
+            std::cerr << "Barrel file " << barrel.path << " does not belong to manifest " << manifest_file
+                      << " (interrupted rewrite?)\n";
+            unload();
+            return;
+        }
+    }
+
+    // Dense slot array is used in place: no parsing, no per-term allocation
+    entries = reinterpret_cast<const BarrelEntry*>(base + header.entries_offset);
+    num_slots = header.num_slots;
+    num_present = header.num_terms;
+    manifest_map.advise(MappedFile::Access::Random);
+
+    // Presence bitmaps are tiny (1 bit per term) and hit on every lookup: read them in now
+    filters = reinterpret_cast<const uint64_t*>(base + header.filters_offset);
+    range_width = header.range_width;
+    corpus_identity = CorpusIdentity{header.num_documents, header.lexicon_terms, header.corpus_fingerprint};
+    manifest_map.prefetch(header.filters_offset, header.num_barrels * filter_words(range_width) * sizeof(uint64_t));
+
+    if (num_present > 0) io_pool = std::make_unique<ThreadPool>(IO_THREADS);
+}
+
+void BarrelsReader::unload() {
+    barrels.clear();
+    entries = nullptr;
+    filters = nullptr;
+    num_slots = 0;
+    num_present = 0;
+    range_width = 0;
+    manifest_map.close();
+}
+
+std::vector<int> BarrelsReader::term_ids() const {
+    std::vector<int> ids;
+    ids.reserve(num_present);
+    for (uint32_t term_id = 0; term_id < num_slots; ++term_id) {
+        if (find_entry(static_cast<int>(term_id))) ids.push_back(static_cast<int>(term_id));
+    }
+    return ids;
 }
 
 // ---------------------------
 // Get postings for term_id
 // ---------------------------
-std::vector<int> BarrelsReader::get_postings(int term_id) {
-    std::vector<int> postings;
+PostingsView BarrelsReader::get_postings_view(int term_id) {
+    PostingsView view;
 
-    auto it = manifest.find(term_id);
-    if (it == manifest.end())
-        return postings;
+    const BarrelEntry* entry = find_entry(term_id);
+    if (!entry || entry->count == 0)
+        return view;
+
+    const Barrel& barrel = barrels[entry->barrel];
+    if (!barrel.map.is_open())
+        return read_postings(term_id, *entry);
+
+    // Skip the record's count prefix; the manifest already knows the length
+    size_t begin = entry->offset + sizeof(uint32_t);
+    if (begin + static_cast<size_t>(entry->count) * sizeof(int32_t) > barrel.map.size())
+        return view;
+
+    // Records are 4-byte aligned (12-byte header + int32 fields)
+    view.data = reinterpret_cast<const int*>(barrel.map.data() + begin);
+    view.size = entry->count;
+    return view;
+}
+
+// Positional-read fallback: decode once, then serve from the postings cache
+PostingsView BarrelsReader::read_postings(int term_id, const BarrelEntry& entry) {
+    PostingsView view;
+
+    // Hot terms never touch the barrel file twice
+    PostingsCache::Postings cached = postings_cache.get(term_id);
+    if (!cached) {
+        const RandomAccessFile& file = barrels[entry.barrel].file;
+        if (!file.is_open())
+            return view;
+
+        auto postings = std::make_shared<std::vector<int>>(entry.count);
+        size_t bytes = static_cast<size_t>(entry.count) * sizeof(int32_t);
+        if (file.read_at(entry.offset + sizeof(uint32_t), postings->data(), bytes) != bytes)
+            return view;
+
+        cached = postings;
+        postings_cache.put(term_id, cached);
+    }
+
+    view.data = cached->data();
+    view.size = cached->size();
+    view.owner = cached;
+    return view;
+}
+
+// ---------------------------
+// Asynchronous multi-term fetch
+// ---------------------------
+bool PostingsFetch::next(int& term_id, PostingsView& view) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready_cv.wait(lock, [this]() { return !ready.empty() || remaining == 0; });
+    if (ready.empty()) return false;
+
+    term_id = ready.front().first;
+    view = std::move(ready.front().second);
+    ready.pop_front();
+    return true;
+}
+
+void PostingsFetch::complete(int term_id, PostingsView view) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.emplace_back(term_id, std::move(view));
+        --remaining;
+    }
+    ready_cv.notify_one();
+}
+
+PostingsView BarrelsReader::load_postings(int term_id) {
+    PostingsView view = get_postings_view(term_id);
+    if (view.owner || view.empty()) return view; // already in memory
+
+    // Touch one int per 4 KB page to fault the mapped range in
+    volatile int sink = 0;
+    const size_t stride = 4096 / sizeof(int);
+    for (size_t i = 0; i < view.size; i += stride) sink += view.data[i];
+    sink += view.data[view.size - 1];
+    (void)sink;
+    return view;
+}
+
+std::shared_ptr<PostingsFetch> BarrelsReader::fetch_async(const std::vector<int>& term_ids) {
+    auto fetch = std::make_shared<PostingsFetch>();
+    fetch->remaining = term_ids.size();
+
+    // Single-term queries gain nothing from a thread hop
+    if (!io_pool || term_ids.size() <= 1) {
+        for (int term_id : term_ids) fetch->complete(term_id, get_postings_view(term_id));
+        return fetch;
+    }
+
+    // Submission phase: non-blocking readahead for the exact range of every list
+    for (int term_id : term_ids) {
+        const BarrelEntry* entry = find_entry(term_id);
+        if (!entry) continue;
+        const MappedFile& map = barrels[entry->barrel].map;
+        if (map.is_open()) {
+            map.prefetch(entry->offset, sizeof(uint32_t) + static_cast<size_t>(entry->count) * sizeof(int32_t));
+        }
+    }
+
+    // Completion phase: each list lands in the fetch queue as soon as it is resident
+    for (int term_id : term_ids) {
+        io_pool->submit([this, fetch, term_id]() {
+            fetch->complete(term_id, load_postings(term_id));
+        });
+    }
+    return fetch;
+}
+
+// ---------------------------
+// Corpus identity
+// ---------------------------
+CorpusIdentity CorpusIdentity::of(const Lexicon& lex, const ForwardIndex& fwd) {
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void* data, size_t len) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
 
-    const BarrelEntry& entry = it->second;
-    auto fin = open_barrel(entry.barrel_file);
-    if (!fin)
+    CorpusIdentity identity;
+    identity.lexicon_terms = static_cast<uint32_t>(lex.get_token_to_id().size());
+    identity.num_documents = static_cast<uint32_t>(fwd.getIndex().size());
+
+    // Term IDs are assigned densely from 0
+    for (uint32_t term_id = 0; term_id < identity.lexicon_terms; ++term_id) {
+        std::string token = lex.get_term_string(static_cast<int>(term_id));
+        uint32_t len = static_cast<uint32_t>(token.size());
+        mix(&len, sizeof(len));
+        mix(token.data(), token.size());
+    }
+
+    // Documents in ID order (the map itself is unordered)
+    std::vector<int> doc_ids;
+    doc_ids.reserve(fwd.getIndex().size());
+    for (const auto& [doc_id, term_ids] : fwd.getIndex()) doc_ids.push_back(doc_id);
+    std::sort(doc_ids.begin(), doc_ids.end());
+    for (int doc_id : doc_ids) {
+        const auto& term_ids = fwd.getIndex().at(doc_id);
+        uint32_t count = static_cast<uint32_t>(term_ids.size());
+        mix(&doc_id, sizeof(doc_id));
+        mix(&count, sizeof(count));
+        mix(term_ids.data(), term_ids.size() * sizeof(int));
+    }
+    identity.fingerprint = hash;
+    return identity;
+}
+
+// ---------------------------
+// Write barrels + manifest
+// ---------------------------
+bool BarrelsWriter::write(const InvertedIndex& inv, const CorpusIdentity& corpus, const std::string& out_dir) {
+    const auto& index = inv.getIndex();
+    std::vector<int> term_ids;
+    term_ids.reserve(index.size());
+    for (const auto& [term_id, postings] : index) term_ids.push_back(term_id);
+    std::sort(term_ids.begin(), term_ids.end());
+    return write_terms(term_ids, [&index](int term_id) { return index.at(term_id); }, corpus, out_dir);
+}
+
+bool BarrelsWriter::write_merged(BarrelsReader& base, const std::unordered_map<int, std::vector<int>>& delta,
+                                 const CorpusIdentity& corpus, const std::string& out_dir) {
+    std::vector<int> term_ids = base.term_ids();
+    for (const auto& [term_id, doc_ids] : delta) {
+        if (term_id >= 0 && !base.may_contain(term_id)) term_ids.push_back(term_id);
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    return write_terms(term_ids, [&base, &delta](int term_id) {
+        std::vector<int> postings = base.get_postings(term_id);
+        auto it = delta.find(term_id);
+        if (it != delta.end()) postings.insert(postings.end(), it->second.begin(), it->second.end());
         return postings;
+    }, corpus, out_dir);
+}
+
+bool BarrelsWriter::replace(const std::string& staging_dir, const std::string& dir, int num_barrels) {
+    // Barrels first, then the manifest that points at them
+    std::vector<std::string> names;
+    for (int barrel = 0; barrel < num_barrels; ++barrel) names.push_back(barrel_name(barrel));
+    names.push_back("manifest.bin");
+    for (const auto& name : names) {
+        std::string from = staging_dir + "/" + name;
+        std::string to = dir + "/" + name;
+        std::remove(to.c_str()); // rename cannot overwrite on Windows
+        if (std::rename(from.c_str(), to.c_str()) != 0) {
+            std::cerr << "[Stage 6] Failed to move " << from << " to " << to << "\n";
+            return false;
+        }
+    }
+    fs::remove(staging_dir);
+    return true;
+}
+
+bool BarrelsWriter::write_terms(const std::vector<int>& term_ids,
+                                const std::function<std::vector<int>(int)>& postings_of,
+                                const CorpusIdentity& corpus, const std::string& out_dir) {
+    fs::create_directories(out_dir);
+    int max_term_id = term_ids.empty() ? -1 : term_ids.back();
+
+    // Contiguous term-ID ranges of equal width
+    int range = (max_term_id + 1 + num_barrels - 1) / num_barrels;
+    if (range <= 0) range = 1;
+
+    // Dense slot array indexed by term ID; absent terms keep NO_BARREL
+    std::vector<BarrelEntry> slots(static_cast<size_t>(max_term_id + 1),
+                                   BarrelEntry{0, BarrelEntry::NO_BARREL, 0});
+
+    // One presence bitmap per barrel over its term-ID range
+    size_t words_per_barrel = filter_words(static_cast<uint32_t>(range));
+    std::vector<uint64_t> filters(num_barrels * words_per_barrel, 0);
 
-    // Seek to offset
-    fin->seekg(entry.offset, std::ios::beg);
+    // Distinguishes this set from any earlier one in the same directory (time guards
+    // against a deterministic random_device)
+    uint64_t build_id = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ corpus.fingerprint ^
+                        static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
 
-    int df;
-    (*fin) >> df;
-    postings.resize(df);
+    size_t next = 0;
+    for (int barrel = 0; barrel < num_barrels; ++barrel) {
+        std::ofstream out(out_dir + "/" + barrel_name(barrel), std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "[Stage 6] Failed to write barrel: " << barrel_name(barrel) << "\n";
+            return false;
+        }
+        out.write(BARREL_MAGIC, sizeof(BARREL_MAGIC));
+        write_pod(out, build_id);
 
-    for (int i = 0; i < df; ++i) {
-        (*fin) >> postings[i];
+        int range_end = (barrel + 1) * range;
+        for (; next < term_ids.size() && term_ids[next] < range_end; ++next) {
+            int term_id = term_ids[next];
+            // Doc IDs sorted; repeats are kept since they carry term frequency
+            std::vector<int> postings = postings_of(term_id);
+            std::sort(postings.begin(), postings.end());
+
+            slots[term_id] = {static_cast<uint64_t>(out.tellp()), static_cast<uint32_t>(barrel),
+                              static_cast<uint32_t>(postings.size())};
+            if (!postings.empty()) {
+                int bit = term_id - barrel * range;
+                filters[barrel * words_per_barrel + bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+            write_pod(out, static_cast<uint32_t>(postings.size()));
+            out.write(reinterpret_cast<const char*>(postings.data()), postings.size() * sizeof(int32_t));
+        }
+        if (!out.good()) return false;
+    }
+
+    std::ofstream man(manifest_path(out_dir), std::ios::binary | std::ios::trunc);
+    if (!man.is_open()) {
+        std::cerr << "[Stage 6] Failed to write manifest in " << out_dir << "\n";
+        return false;
     }
+    // Header is patched with entries_offset once the name table is written
+    ManifestHeader header = {};
+    std::memcpy(header.magic, MANIFEST_MAGIC, sizeof(header.magic));
+    header.version = MANIFEST_VERSION;
+    header.num_barrels = static_cast<uint32_t>(num_barrels);
+    header.num_slots = static_cast<uint32_t>(slots.size());
+    header.num_terms = static_cast<uint32_t>(term_ids.size());
+    header.range_width = static_cast<uint32_t>(range);
+    header.num_documents = corpus.num_documents;
+    header.lexicon_terms = corpus.lexicon_terms;
+    header.corpus_fingerprint = corpus.fingerprint;
+    header.build_id = build_id;
+    write_pod(man, header);
 
-    return postings;
-}
\ No newline at end of file
+    for (int barrel = 0; barrel < num_barrels; ++barrel) {
+        std::string name = barrel_name(barrel);
+        write_pod(man, static_cast<uint32_t>(name.size()));
+        man.write(name.data(), name.size());
+    }
+    while (static_cast<uint64_t>(man.tellp()) % alignof(BarrelEntry) != 0) man.put('\0');
+
+    header.entries_offset = static_cast<uint64_t>(man.tellp());
+    man.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(BarrelEntry));
+
+    header.filters_offset = static_cast<uint64_t>(man.tellp()); // 16-byte slots keep 8-byte alignment
+    man.write(reinterpret_cast<const char*>(filters.data()), filters.size() * sizeof(uint64_t));
+    man.seekp(0);
+    write_pod(man, header);
+    return man.good();
+}
@@ -1,81 +1,315 @@
 #include "stage7_semantic.h"
 #include "stage1_lexicon.h"
+#include "stage2_forward_index.h"
 #include "stage4_ranking.h"
+#include "embedding_file.h"
+#include "vector_kernels.h"
+#include "hnsw_index.h"
+#include "ivfpq_index.h"
+#include "term_expansion.h"
+#include "thread_pool.h"
 #include <fstream>
-#include <sstream>
+#include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
 
-SemanticEngine::SemanticEngine(const std::string& glove_file, int dim)
-    : dimension(dim) // initialize dimension
+SemanticEngine::SemanticEngine(const std::string& glove_file, int dim, const Lexicon& lex, bool keep_oov)
+    : lexicon(lex), dimension(dim), row_stride((dim + 15) / 16 * 16), keep_oov(keep_oov)
 {
+    // One zeroed row per lexicon term; rows without a GloVe vector stay unused
+    size_t num_rows = lexicon.get_token_to_id().size();
+    embedding_matrix.assign(num_rows * row_stride, 0.0f);
+    has_embedding.assign(num_rows, 0);
+
+    // Prefer the binary cache (mmap, no parsing); build it on first run or when stale
+    std::string cache_file = EmbeddingFile::cache_path(glove_file);
+    auto cache = std::make_unique<EmbeddingFile>();
+    bool cached = cache->open(cache_file, glove_file, dim);
+    if (!cached && EmbeddingFile::convert(glove_file, cache_file, dim)) {
+        cached = cache->open(cache_file, glove_file, dim);
+        if (cached) std::cout << "[Stage 7] Built binary embedding cache: " << cache_file << "\n";
+    }
+
+    if (cached) {
+        load_from_cache(*cache);
+        // Later terms and OOV lookups go straight to the mapped file instead of a copied table
+        glove_cache = std::move(cache);
+    } else {
+        load_from_text(glove_file, keep_oov);
+    }
+}
+
+SemanticEngine::~SemanticEngine() = default;
+
+void SemanticEngine::load_from_cache(const EmbeddingFile& cache) {
+    for (const auto& [token, term_id] : lexicon.get_token_to_id()) {
+        if (term_id < 0 || static_cast<size_t>(term_id) >= has_embedding.size()) continue;
+        const float* src = cache.find(token);
+        if (!src) continue;
+        std::copy(src, src + dimension, &embedding_matrix[static_cast<size_t>(term_id) * row_stride]);
+        has_embedding[term_id] = 1;
+        ++embedded_terms;
+    }
+}
+
+void SemanticEngine::load_from_text(const std::string& glove_file, bool keep_oov) {
     std::ifstream infile(glove_file);
     if (!infile) throw std::runtime_error("Cannot open GloVe file: " + glove_file);
 
+    size_t num_rows = has_embedding.size();
     std::string line;
     while (std::getline(infile, line)) {
-        std::istringstream iss(line);
-        std::string word;
-        iss >> word;
-        std::vector<double> vec(dim, 0.0);
-        for (int i = 0; i < dim; ++i) iss >> vec[i];
-        embeddings[word] = vec;
+        size_t space = line.find(' ');
+        if (space == std::string::npos) continue;
+        std::string word = line.substr(0, space);
+
+        // Only words in the corpus vocabulary are kept (plus the optional OOV table)
+        float* row = nullptr;
+        int term_id = lexicon.get_term_id(word);
+        if (term_id >= 0 && static_cast<size_t>(term_id) < num_rows) {
+            if (has_embedding[term_id]) continue;
+            row = &embedding_matrix[static_cast<size_t>(term_id) * row_stride];
+            has_embedding[term_id] = 1;
+            ++embedded_terms;
+        } else if (keep_oov && !oov_rows.count(word)) {
+            oov_rows[word] = static_cast<int>(oov_rows.size());
+            oov_matrix.resize(oov_matrix.size() + row_stride, 0.0f);
+            row = &oov_matrix[oov_matrix.size() - row_stride];
+        } else {
+            continue; // skip parsing the numbers entirely
+        }
+
+        const char* cursor = line.c_str() + space;
+        for (int i = 0; i < dimension; ++i) {
+            char* end = nullptr;
+            row[i] = std::strtof(cursor, &end);
+            if (end == cursor) break;
+            cursor = end;
+        }
     }
 }
 
-void SemanticEngine::build_document_vectors(const std::vector<std::string>& documents,
-                                            const Lexicon& lex,
-                                            const Stage4Ranking& ranker)
-{
-    doc_vectors.clear();
-    for (const auto& doc : documents) {
-        std::vector<double> vec(dimension, 0.0);
-        std::istringstream iss(doc);
-        std::string token;
-        int count = 0;
-        while (iss >> token) {
-            std::transform(token.begin(), token.end(), token.begin(), ::tolower);
-            if (embeddings.find(token) != embeddings.end()) {
-                for (int i = 0; i < dimension; ++i) vec[i] += embeddings[token][i];
-                ++count;
-            }
+const float* SemanticEngine::term_vector(int term_id) const {
+    if (term_id < 0) return nullptr;
+    if (static_cast<size_t>(term_id) < has_embedding.size()) {
+        return has_embedding[term_id] ? &embedding_matrix[static_cast<size_t>(term_id) * row_stride] : nullptr;
+    }
+    // Term added after load (Stage 9) and not yet in the matrix: only the OOV table can know it
+    if (!keep_oov) return nullptr;
+    return token_vector(lexicon.get_term_string(term_id));
+}
+
+const float* SemanticEngine::token_vector(const std::string& token) const {
+    int term_id = lexicon.get_term_id(token);
+    if (term_id >= 0 && static_cast<size_t>(term_id) < has_embedding.size()) return term_vector(term_id);
+
+    if (!keep_oov) return nullptr;
+    if (glove_cache) return glove_cache->find(token);
+    auto it = oov_rows.find(token);
+    if (it == oov_rows.end()) return nullptr;
+    return &oov_matrix[static_cast<size_t>(it->second) * row_stride];
+}
+
+size_t SemanticEngine::add_new_terms() {
+    size_t old_rows = has_embedding.size();
+    size_t num_rows = lexicon.get_token_to_id().size();
+    if (num_rows <= old_rows) return 0;
+    embedding_matrix.resize(num_rows * row_stride, 0.0f);
+    has_embedding.resize(num_rows, 0);
+
+    size_t found = 0;
+    for (size_t term_id = old_rows; term_id < num_rows; ++term_id) {
+        std::string token = lexicon.get_term_string(static_cast<int>(term_id));
+        const float* src = nullptr;
+        if (glove_cache) {
+            src = glove_cache->find(token);
+        } else {
+            auto it = oov_rows.find(token);
+            if (it != oov_rows.end()) src = &oov_matrix[static_cast<size_t>(it->second) * row_stride];
         }
-        if (count > 0)
-            for (int i = 0; i < dimension; ++i) vec[i] /= count;
-        doc_vectors.push_back(vec);
+        if (!src) continue;
+        std::copy(src, src + dimension, &embedding_matrix[term_id * row_stride]);
+        has_embedding[term_id] = 1;
+        ++found;
     }
+    embedded_terms += found;
+    return found;
 }
 
-void SemanticEngine::rerank(const std::string& query,
-                            std::vector<SearchResult>& results,
-                            const Lexicon& lex,
-                            const Stage4Ranking& ranker)
-{
-    std::vector<double> query_vec(dimension, 0.0);
-    std::istringstream iss(query);
-    std::string token;
+size_t SemanticEngine::embedding_memory_bytes() const {
+    size_t bytes = embedding_matrix.capacity() * sizeof(float) + has_embedding.capacity();
+    bytes += oov_matrix.capacity() * sizeof(float);
+    for (const auto& [word, row] : oov_rows) bytes += sizeof(word) + word.capacity() + sizeof(row) + 32;
+    return bytes;
+}
+
+AlignedFloatVector SemanticEngine::embed_terms(const std::vector<int>& term_ids) const {
+    AlignedFloatVector vec(row_stride);
+    average_terms(term_ids, vec.data());
+    normalize_l2(vec.data(), row_stride);
+    return vec;
+}
+
+uint64_t SemanticEngine::embedding_fingerprint() const {
+    return matrix_fingerprint(embedding_matrix.data(), has_embedding.size(), row_stride);
+}
+
+bool SemanticEngine::build_expansion_table(const std::string& path, int k, size_t num_threads) const {
+    // Unit-length copies of the embedded rows only, so the product skips terms without a vector
+    std::vector<int> row_terms;
+    for (size_t term_id = 0; term_id < has_embedding.size(); ++term_id) {
+        if (has_embedding[term_id]) row_terms.push_back(static_cast<int>(term_id));
+    }
+    AlignedFloatVector rows(row_terms.size() * row_stride);
+    for (size_t i = 0; i < row_terms.size(); ++i) {
+        float* row = &rows[i * row_stride];
+        const float* src = &embedding_matrix[static_cast<size_t>(row_terms[i]) * row_stride];
+        std::copy(src, src + row_stride, row);
+        normalize_l2(row, row_stride);
+    }
+    return TermExpansionTable::build(rows.data(), row_terms, row_stride, has_embedding.size(), k, num_threads,
+                                     embedding_fingerprint(), path);
+}
+
+size_t SemanticEngine::TermIdsHash::operator()(const std::vector<int>& ids) const {
+    // FNV-1a over the IDs
+    uint64_t h = 1469598103934665603ULL;
+    for (int id : ids) {
+        h ^= static_cast<uint32_t>(id);
+        h *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(h);
+}
+
+std::shared_ptr<const AlignedFloatVector> SemanticEngine::query_embedding(const std::vector<int>& term_ids) const {
+    // The average is order-independent: "car hire" and "hire car" share an entry
+    std::vector<int> key = term_ids;
+    std::sort(key.begin(), key.end());
+
+    std::lock_guard<std::mutex> lock(query_cache_mutex);
+    auto it = query_lookup.find(key);
+    if (it != query_lookup.end()) {
+        ++query_hits;
+        query_lru.splice(query_lru.begin(), query_lru, it->second);
+        return it->second->second;
+    }
+    ++query_misses;
+    auto vec = std::make_shared<const AlignedFloatVector>(embed_terms(key));
+    if (query_cache_capacity == 0) return vec;
+    query_lru.emplace_front(key, vec);
+    query_lookup[std::move(key)] = query_lru.begin();
+    if (query_lru.size() > query_cache_capacity) {
+        query_lookup.erase(query_lru.back().first);
+        query_lru.pop_back();
+    }
+    return vec;
+}
+
+void SemanticEngine::set_query_cache_capacity(size_t entries) {
+    std::lock_guard<std::mutex> lock(query_cache_mutex);
+    query_cache_capacity = entries;
+    while (query_lru.size() > query_cache_capacity) {
+        query_lookup.erase(query_lru.back().first);
+        query_lru.pop_back();
+    }
+}
+
+uint64_t SemanticEngine::query_cache_hits() const {
+    std::lock_guard<std::mutex> lock(query_cache_mutex);
+    return query_hits;
+}
+
+uint64_t SemanticEngine::query_cache_misses() const {
+    std::lock_guard<std::mutex> lock(query_cache_mutex);
+    return query_misses;
+}
+
+void SemanticEngine::average_terms(const std::vector<int>& term_ids, float* out) const {
+    std::fill(out, out + row_stride, 0.0f);
     int count = 0;
-    while (iss >> token) {
-        std::transform(token.begin(), token.end(), token.begin(), ::tolower);
-        if (embeddings.find(token) != embeddings.end()) {
-            for (int i = 0; i < dimension; ++i) query_vec[i] += embeddings[token][i];
+    for (int term_id : term_ids) {
+        const float* emb = term_vector(term_id);
+        if (emb) {
+            for (int i = 0; i < dimension; ++i) out[i] += emb[i];
             ++count;
         }
     }
-    if (count > 0)
-        for (int i = 0; i < dimension; ++i) query_vec[i] /= count;
+    if (count > 0) {
+        float inv = 1.0f / count;
+        for (int i = 0; i < dimension; ++i) out[i] *= inv;
+    }
+}
 
-    for (auto& res : results) {
-        if (res.doc_id >= doc_vectors.size()) continue;
-        const auto& doc_vec = doc_vectors[res.doc_id];
+void SemanticEngine::build_document_vectors(const ForwardIndex& fwd_index, size_t num_documents, size_t num_threads) {
+    hnsw.reset(); // indexes would refer to the old rows
+    ivfpq.reset();
+    num_docs = num_documents;
+    doc_matrix.assign(num_docs * row_stride, 0.0f);
+    float_rows_released = false;
 
-        double dot = 0.0, norm_q = 0.0, norm_d = 0.0;
-        for (int i = 0; i < dimension; ++i) {
-            dot += query_vec[i] * doc_vec[i];
-            norm_q += query_vec[i] * query_vec[i];
-            norm_d += doc_vec[i] * doc_vec[i];
+    doc_f16.clear();
+    doc_i8.clear();
+    doc_scales.clear();
+    if (storage == VectorStorage::Float16) doc_f16.resize(num_docs * row_stride);
+    if (storage == VectorStorage::Int8) {
+        doc_i8.resize(num_docs * row_stride);
+        doc_scales.resize(num_docs);
+    }
+
+    // Each range writes only its own rows; the forward index and embeddings are read-only here
+    const auto& postings = fwd_index.getIndex();
+    ThreadPool pool(num_threads);
+    pool.parallel_for(num_docs, [&](size_t begin, size_t end) {
+        for (size_t doc_id = begin; doc_id < end; ++doc_id) {
+            auto it = postings.find(static_cast<int>(doc_id));
+            if (it == postings.end()) continue; // no indexed terms: zero vector
+            float* row = &doc_matrix[doc_id * row_stride];
+            average_terms(it->second, row);
+            // Normalized once here so queries never recompute document norms
+            normalize_l2(row, row_stride);
+            if (storage != VectorStorage::Float32) store_quantized(doc_id, row);
+        }
+    }, 256);
+}
+
+void SemanticEngine::store_quantized(size_t doc_id, const float* row) {
+    size_t offset = doc_id * row_stride;
+    if (storage == VectorStorage::Float16) {
+        for (int i = 0; i < row_stride; ++i) doc_f16[offset + i] = float_to_half(row[i]);
+    } else if (storage == VectorStorage::Int8) {
+        // Symmetric per-vector scale: the largest component maps to +-127
+        float max_abs = 0.0f;
+        for (int i = 0; i < row_stride; ++i) max_abs = std::max(max_abs, std::fabs(row[i]));
+        float scale = max_abs / 127.0f;
+        float inv = scale > 0.0f ? 1.0f / scale : 0.0f;
+        for (int i = 0; i < row_stride; ++i) {
+            long q = std::lround(row[i] * inv);
+            doc_i8[offset + i] = static_cast<int8_t>(std::max(-127L, std::min(127L, q)));
         }
-        double cos_sim = (norm_q && norm_d) ? dot / (std::sqrt(norm_q) * std::sqrt(norm_d)) : 0.0;
+        doc_scales[doc_id] = scale;
+    }
+}
+
+float SemanticEngine::document_similarity(const float* query_vec, size_t doc_id) const {
+    size_t offset = doc_id * row_stride;
+    switch (storage) {
+        case VectorStorage::Float16:
+            return dot_product_f16(query_vec, &doc_f16[offset], row_stride);
+        case VectorStorage::Int8:
+            return doc_scales[doc_id] * dot_product_i8(query_vec, &doc_i8[offset], row_stride);
+        default:
+            return dot_product(query_vec, &doc_matrix[offset], row_stride);
+    }
+}
+
+void SemanticEngine::rerank(const float* query_vec, std::vector<SearchResult>& results) const {
+    for (auto& res : results) {
+        if (res.doc_id < 0 || static_cast<size_t>(res.doc_id) >= num_docs) continue;
+        // Both sides are unit length (or zero), so the dot product is the cosine
+        double cos_sim = document_similarity(query_vec, static_cast<size_t>(res.doc_id));
 
         res.score = 0.7 * res.score + 0.3 * cos_sim;
     }
@@ -83,49 +317,154 @@ void SemanticEngine::rerank(const std::string& query,
 
 // Semantic search for debug mode (returns cosine similarity scores only)
 std::vector<SearchResult> SemanticEngine::semantic_search(const std::string& query, int top_k) {
+    // Same tokenization and term IDs as QueryEngine, so the cached query vector is shared
+    std::vector<int> term_ids;
+    for (const auto& token : Lexicon::tokenize_and_filter(query)) {
+        int term_id = lexicon.get_term_id(token);
+        if (term_id != -1) term_ids.push_back(term_id);
+    }
+    auto query_vec = query_embedding(term_ids);
+    return search_vector(query_vec->data(), top_k, !has_ann_index());
+}
+
+std::vector<SearchResult> SemanticEngine::search_vector(const float* query_vec, int top_k, bool exact, int search_width) const {
     std::vector<SearchResult> results;
-    
-    // Build query vector (same logic as rerank)
-    std::vector<double> query_vec(dimension, 0.0);
-    std::istringstream iss(query);
-    std::string token;
-    int count = 0;
-    while (iss >> token) {
-        std::transform(token.begin(), token.end(), token.begin(), ::tolower);
-        if (embeddings.find(token) != embeddings.end()) {
-            for (int i = 0; i < dimension; ++i) query_vec[i] += embeddings[token][i];
-            ++count;
+    if (top_k <= 0) return results;
+
+    if (!exact && has_ann_index()) {
+        auto hits = hnsw ? hnsw->search(query_vec, static_cast<size_t>(top_k), search_width)
+                         : ivfpq->search(query_vec, static_cast<size_t>(top_k), search_width);
+        for (const auto& [doc_id, sim] : hits) {
+            if (sim <= 0.0f) continue;
+            SearchResult res;
+            res.doc_id = doc_id;
+            res.score = sim;
+            res.snippet = "";
+            results.push_back(res);
         }
+        return results;
     }
-    if (count > 0)
-        for (int i = 0; i < dimension; ++i) query_vec[i] /= count;
-    
-    // Compute cosine similarity for all documents
-    for (size_t doc_id = 0; doc_id < doc_vectors.size(); ++doc_id) {
-        const auto& doc_vec = doc_vectors[doc_id];
-        
-        double dot = 0.0, norm_q = 0.0, norm_d = 0.0;
-        for (int i = 0; i < dimension; ++i) {
-            dot += query_vec[i] * doc_vec[i];
-            norm_q += query_vec[i] * query_vec[i];
-            norm_d += doc_vec[i] * doc_vec[i];
-        }
-        double cos_sim = (norm_q && norm_d) ? dot / (std::sqrt(norm_q) * std::sqrt(norm_d)) : 0.0;
-        
-        if (cos_sim > 0.0) { // Only include documents with some similarity
+
+    // Cosine similarity for all documents in one pass over the contiguous matrix
+    std::vector<float> scores(num_docs);
+    if (storage == VectorStorage::Float32) {
+        dot_product_batch(query_vec, doc_matrix.data(), row_stride, num_docs, row_stride, scores.data());
+    } else {
+        for (size_t doc_id = 0; doc_id < num_docs; ++doc_id) scores[doc_id] = document_similarity(query_vec, doc_id);
+    }
+
+    for (size_t doc_id = 0; doc_id < num_docs; ++doc_id) {
+        if (scores[doc_id] > 0.0f) { // Only include documents with some similarity
             SearchResult res;
             res.doc_id = static_cast<int>(doc_id);
-            res.score = cos_sim; // Pure cosine similarity (no BM25 mixing)
+            res.score = scores[doc_id]; // Pure cosine similarity (no BM25 mixing)
             res.snippet = "";
             results.push_back(res);
         }
     }
-    
-    // Sort by cosine similarity descending
-    std::sort(results.begin(), results.end(), [](const SearchResult& a, const SearchResult& b) {
-        return a.score > b.score;
-    });
-    
-    if (results.size() > (size_t)top_k) results.resize(top_k);
+
+    // Only the top_k need ordering
+    auto by_score = [](const SearchResult& a, const SearchResult& b) { return a.score > b.score; };
+    size_t keep = std::min(results.size(), static_cast<size_t>(top_k));
+    std::partial_sort(results.begin(), results.begin() + keep, results.end(), by_score);
+    results.resize(keep);
     return results;
-}
\ No newline at end of file
+}
+
+bool SemanticEngine::document_vector(int doc_id, float* out) const {
+    if (doc_id < 0 || static_cast<size_t>(doc_id) >= num_docs) return false;
+    size_t offset = static_cast<size_t>(doc_id) * row_stride;
+    if (!float_rows_released) {
+        std::copy(&doc_matrix[offset], &doc_matrix[offset] + row_stride, out);
+    } else if (storage == VectorStorage::Float16) {
+        for (int i = 0; i < row_stride; ++i) out[i] = half_to_float(doc_f16[offset + i]);
+    } else {
+        for (int i = 0; i < row_stride; ++i) out[i] = doc_i8[offset + i] * doc_scales[doc_id];
+    }
+    return true;
+}
+
+bool SemanticEngine::release_float_vectors() {
+    if (storage == VectorStorage::Float32 || hnsw || float_rows_released) return false;
+    AlignedFloatVector().swap(doc_matrix);
+    float_rows_released = true;
+    return true;
+}
+
+size_t SemanticEngine::document_memory_bytes() const {
+    return doc_matrix.capacity() * sizeof(float) + doc_f16.capacity() * sizeof(uint16_t) +
+           doc_i8.capacity() + doc_scales.capacity() * sizeof(float);
+}
+
+void SemanticEngine::build_ann_index(const HnswParams& params, const std::string& index_file, size_t num_threads) {
+    if (float_rows_released) {
+        std::cerr << "[Stage 7] Warning: float vectors were released; cannot build HNSW index\n";
+        return;
+    }
+    ivfpq.reset();
+    hnsw = std::make_unique<HnswIndex>(doc_matrix, row_stride, params);
+    if (hnsw->load(index_file, num_docs)) {
+        std::cout << "[Stage 7] Loaded HNSW index: " << index_file << " (" << num_docs << " vectors)\n";
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    hnsw->build(num_docs, num_threads);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "[Stage 7] Built HNSW index over " << num_docs << " vectors in " << ms << " ms ("
+              << num_threads << " threads)\n";
+    if (!hnsw->save(index_file)) {
+        std::cerr << "[Stage 7] Warning: could not write HNSW index to " << index_file << "\n";
+    }
+}
+
+void SemanticEngine::build_ivfpq_index(const IvfPqParams& params, const std::string& index_file, size_t num_threads) {
+    if (float_rows_released) {
+        std::cerr << "[Stage 7] Warning: float vectors were released; cannot build IVF-PQ index\n";
+        return;
+    }
+    hnsw.reset();
+    ivfpq = std::make_unique<IvfPqIndex>(row_stride, params);
+    uint64_t fingerprint = matrix_fingerprint(doc_matrix.data(), num_docs, row_stride);
+    if (ivfpq->load(index_file, num_docs, fingerprint)) {
+        std::cout << "[Stage 7] Loaded IVF-PQ index: " << index_file << " (" << num_docs << " vectors)\n";
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ivfpq->train_and_add(doc_matrix.data(), num_docs, num_threads);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "[Stage 7] Trained IVF-PQ index over " << num_docs << " vectors in " << ms << " ms ("
+              << num_threads << " threads)\n";
+    if (!ivfpq->save(index_file, fingerprint)) {
+        std::cerr << "[Stage 7] Warning: could not write IVF-PQ index to " << index_file << "\n";
+    }
+}
+
+size_t SemanticEngine::ann_memory_bytes() const {
+    if (hnsw) return hnsw->memory_bytes();
+    return ivfpq ? ivfpq->memory_bytes() : 0;
+}
+
+bool SemanticEngine::add_document_vector(int doc_id, const float* vec) {
+    if (doc_id < 0 || static_cast<size_t>(doc_id) < num_docs) return false;
+
+    // Rows for any skipped IDs stay zero (no similarity to anything)
+    num_docs = static_cast<size_t>(doc_id) + 1;
+    if (!float_rows_released) {
+        doc_matrix.resize(num_docs * row_stride, 0.0f);
+        std::copy(vec, vec + row_stride, &doc_matrix[static_cast<size_t>(doc_id) * row_stride]);
+    }
+    if (storage == VectorStorage::Float16) doc_f16.resize(num_docs * row_stride, 0);
+    if (storage == VectorStorage::Int8) {
+        doc_i8.resize(num_docs * row_stride, 0);
+        doc_scales.resize(num_docs, 0.0f);
+    }
+    if (storage != VectorStorage::Float32) store_quantized(static_cast<size_t>(doc_id), vec);
+
+    if (hnsw) hnsw->add(static_cast<uint32_t>(doc_id));
+    if (ivfpq) ivfpq->add(static_cast<uint32_t>(doc_id), vec);
+    return true;
+}
@@ -1,7 +1,14 @@
 #include "stage8_autocomplete.h"
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <queue>
 #include <sstream>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
 
 // Helper: lowercase
 static std::string to_lower(const std::string& s) {
@@ -12,76 +19,598 @@ static std::string to_lower(const std::string& s) {
 
 void Autocomplete::build_trie() {
     // Build from documents (backward compatibility)
+    std::unordered_set<std::string> unique_tokens;
     for (const auto& doc : documents) {
         std::istringstream iss(doc);
         std::string token;
         while (iss >> token) {
-            token = to_lower(token);
-            auto node = root;
-            for (char c : token) {
-                if (!node->children.count(c)) {
-                    node->children[c] = std::make_shared<TrieNode>();
-                }
-                node = node->children[c];
-            }
-            node->is_word = true;
-            node->word = token;
+            unique_tokens.insert(to_lower(token));
         }
     }
+    std::vector<std::string> words(unique_tokens.begin(), unique_tokens.end());
+    bulk_load(words);
 }
 
 // Added for Stage 9 compatibility: Lexicon-driven autocomplete
 void Autocomplete::rebuild_from_lexicon() {
-    // Clear existing trie
-    root = std::make_shared<TrieNode>();
-    
     // Build trie from all tokens in lexicon (industry standard)
     const auto& token_to_id = lexicon.get_token_to_id();
+    std::vector<std::string> words;
+    words.reserve(token_to_id.size());
     for (const auto& [token, term_id] : token_to_id) {
-        std::string lower_token = to_lower(token);
-        auto node = root;
-        for (char c : lower_token) {
-            if (!node->children.count(c)) {
-                node->children[c] = std::make_shared<TrieNode>();
-            }
-            node = node->children[c];
+        words.push_back(to_lower(token));
+    }
+    bulk_load(words);
+}
+
+void Autocomplete::bulk_load(std::vector<std::string>& words) {
+    // Labels are at most one word long; longer tokens are not worth completing
+    words.erase(std::remove_if(words.begin(), words.end(), [](const std::string& w) {
+        return w.size() > std::numeric_limits<uint16_t>::max();
+    }), words.end());
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    nodes.clear();
+    labels.clear();
+    word_nodes.clear();
+    word_terms.clear();
+    dead_nodes = 0;
+    parents.assign(1, 0);
+    nodes.push_back(TrieNode{0, 0, NOT_A_WORD, 0, 0});
+    build_children(0, words, 0, words.size(), 0);
+    nodes.shrink_to_fit();
+    labels.shrink_to_fit();
+    parents.shrink_to_fit();
+
+    top_offset.assign(nodes.size(), 0);
+    top_lists.assign(1, 0);
+    uint32_t ordinal = 0;
+    std::vector<Completion> root_best;
+    precompute_top(0, ordinal, root_best);
+    top_lists.shrink_to_fit();
+}
+
+static bool better_completion(int df_a, uint32_t ordinal_a, int df_b, uint32_t ordinal_b) {
+    return df_a != df_b ? df_a > df_b : ordinal_a < ordinal_b;
+}
+
+size_t Autocomplete::precompute_top(uint32_t node, uint32_t& ordinal, std::vector<Completion>& out) {
+    // Preorder over children sorted by byte visits words in sorted order
+    out.clear();
+    size_t count = 0;
+    if (nodes[node].word != NOT_A_WORD) {
+        uint32_t word = static_cast<uint32_t>(nodes[node].word);
+        out.push_back(Completion{word_df(word), ordinal++, word});
+        ++count;
+    }
+    std::vector<Completion> child_best;
+    for (uint32_t c = nodes[node].first_child; c < nodes[node].first_child + nodes[node].num_children; ++c) {
+        count += precompute_top(c, ordinal, child_best);
+        out.insert(out.end(), child_best.begin(), child_best.end());
+    }
+
+    auto by_rank = [](const Completion& a, const Completion& b) {
+        return better_completion(a.df, a.ordinal, b.df, b.ordinal);
+    };
+    size_t keep = std::min(out.size(), TOP_K);
+    std::partial_sort(out.begin(), out.begin() + keep, out.end(), by_rank);
+    out.resize(keep);
+
+    // With more than TOP_K words below, a list is always full, so updates rewrite it in place
+    if (count > TOP_K) {
+        top_offset[node] = static_cast<uint32_t>(top_lists.size());
+        top_lists.push_back(static_cast<uint32_t>(out.size()));
+        for (const auto& completion : out) top_lists.push_back(completion.word);
+    }
+    return count;
+}
+
+int Autocomplete::word_df(uint32_t word) const {
+    int term_id = word_terms[word];
+    return term_id >= 0 ? lexicon.get_df(term_id) : 0;
+}
+
+// Same order as the bulk build: df descending, then byte order of the words
+bool Autocomplete::better_word(uint32_t a, uint32_t b) const {
+    int df_a = word_df(a);
+    int df_b = word_df(b);
+    if (df_a != df_b) return df_a > df_b;
+    return word_at(word_nodes[a]) < word_at(word_nodes[b]);
+}
+
+std::string Autocomplete::word_at(uint32_t node) const {
+    std::vector<uint32_t> path;
+    for (; node != 0; node = parents[node]) path.push_back(node);
+    std::string word;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        word.append(labels, nodes[*it].label_offset, nodes[*it].label_length);
+    }
+    return word;
+}
+
+// words[lo, hi) all start with the depth-byte string that spells `node`
+void Autocomplete::build_children(uint32_t node, const std::vector<std::string>& words, size_t lo, size_t hi, size_t depth) {
+    if (lo < hi && words[lo].size() == depth) {
+        nodes[node].word = static_cast<int32_t>(word_nodes.size());
+        word_nodes.push_back(node);
+        word_terms.push_back(lexicon.get_term_id(words[lo]));
+        ++lo;
+    }
+
+    // One child per distinct next byte; the words under each form a contiguous range
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t i = lo; i < hi;) {
+        size_t j = i + 1;
+        while (j < hi && words[j][depth] == words[i][depth]) ++j;
+        groups.emplace_back(i, j);
+        i = j;
+    }
+
+    // Children are allocated as one block before recursing, so they stay contiguous
+    uint32_t first = static_cast<uint32_t>(nodes.size());
+    nodes[node].first_child = first;
+    nodes[node].num_children = static_cast<uint16_t>(groups.size());
+    nodes.resize(nodes.size() + groups.size());
+    parents.resize(nodes.size(), node);
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+        auto [a, b] = groups[g];
+        // In a sorted range, the prefix shared by the first and last word is shared by all
+        const std::string& first_word = words[a];
+        const std::string& last_word = words[b - 1];
+        size_t end = depth + 1;
+        while (end < first_word.size() && end < last_word.size() && first_word[end] == last_word[end]) ++end;
+
+        nodes[first + g] = TrieNode{static_cast<uint32_t>(labels.size()), 0, NOT_A_WORD,
+                                    static_cast<uint16_t>(end - depth), 0};
+        labels.append(first_word, depth, end - depth);
+        build_children(first + static_cast<uint32_t>(g), words, a, b, end);
+    }
+}
+
+void Autocomplete::insert_term(const std::string& term) {
+    uint32_t word = insert_word(to_lower(term));
+    if (word == NO_NODE) return;
+    rerank_path(word);
+    if (dead_nodes > nodes.size() / 2) compact();
+}
+
+bool Autocomplete::update_weight(const std::string& term) {
+    std::string word = to_lower(term);
+    std::string spelled;
+    uint32_t node = nodes.empty() ? NO_NODE : descend(word, spelled);
+    if (node == NO_NODE || spelled.size() != word.size() || nodes[node].word == NOT_A_WORD) return false;
+
+    uint32_t id = static_cast<uint32_t>(nodes[node].word);
+    word_terms[id] = lexicon.get_term_id(word);
+    rerank_path(id);
+    return true;
+}
+
+void Autocomplete::refresh_terms(const std::vector<std::string>& terms) {
+    // Per-path updates cost O(depth x TOP_K) each; a bulk load is linear in the vocabulary
+    if (terms.size() * REBUILD_FRACTION > num_words()) {
+        rebuild_from_lexicon();
+        return;
+    }
+
+    // The batch's dfs all changed before any list was fixed, so reranking one
+    // word at a time would compare against stale lists. Instead, place every
+    // word first, then rebuild each affected list once, deepest first, from
+    // children lists that already reflect the whole batch.
+    std::vector<uint32_t> batch;
+    for (const auto& term : terms) {
+        uint32_t word = insert_word(to_lower(term));
+        if (word != NO_NODE) batch.push_back(word);
+    }
+
+    // Paths are read only now: later inserts may have moved earlier words' nodes
+    std::vector<std::pair<size_t, uint32_t>> affected; // (depth, node)
+    std::unordered_set<uint32_t> seen;
+    for (uint32_t word : batch) {
+        std::vector<uint32_t> path;
+        for (uint32_t node = word_nodes[word]; seen.insert(node).second; node = parents[node]) {
+            path.push_back(node);
+            if (node == 0) break;
+        }
+        for (uint32_t node : path) affected.emplace_back(0, node);
+    }
+    for (auto& [depth, node] : affected) {
+        for (uint32_t n = node; n != 0; n = parents[n]) ++depth;
+    }
+    std::sort(affected.begin(), affected.end(), std::greater<std::pair<size_t, uint32_t>>());
+    for (const auto& entry : affected) refresh_list(entry.second);
+
+    if (dead_nodes > nodes.size() / 2) compact();
+}
+
+// Word ID of word, added to the trie (without touching any list) if it was missing
+uint32_t Autocomplete::insert_word(const std::string& word) {
+    if (word.empty() || word.size() > std::numeric_limits<uint16_t>::max()) return NO_NODE;
+    if (nodes.empty()) {
+        std::vector<std::string> none;
+        bulk_load(none);
+    }
+
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < word.size()) {
+        const TrieNode& n = nodes[node];
+        unsigned char c = static_cast<unsigned char>(word[pos]);
+        uint32_t slot = 0;
+        while (slot < n.num_children &&
+               static_cast<unsigned char>(labels[nodes[n.first_child + slot].label_offset]) < c) ++slot;
+        uint32_t child = n.first_child + slot;
+        if (slot == n.num_children || static_cast<unsigned char>(labels[nodes[child].label_offset]) != c) {
+            node = add_child(node, slot, word, pos);
+            break;
+        }
+
+        size_t length = nodes[child].label_length;
+        size_t common = 1;
+        while (common < length && pos + common < word.size() &&
+               labels[nodes[child].label_offset + common] == word[pos + common]) ++common;
+        if (common < length) split_node(child, common);
+        node = child;
+        pos += common;
+    }
+
+    if (nodes[node].word == NOT_A_WORD) {
+        nodes[node].word = static_cast<int32_t>(word_nodes.size());
+        word_nodes.push_back(node);
+        word_terms.push_back(lexicon.get_term_id(word));
+    } else {
+        word_terms[nodes[node].word] = lexicon.get_term_id(word);
+    }
+    return static_cast<uint32_t>(nodes[node].word);
+}
+
+// Relocate a node: its children and its word entry follow it, the old slot is abandoned
+void Autocomplete::move_node(uint32_t from, uint32_t to) {
+    nodes[to] = nodes[from];
+    parents[to] = parents[from];
+    top_offset[to] = top_offset[from];
+    top_offset[from] = 0;
+    const TrieNode& n = nodes[to];
+    for (uint32_t c = n.first_child; c < n.first_child + n.num_children; ++c) parents[c] = to;
+    if (n.word != NOT_A_WORD) word_nodes[n.word] = to;
+}
+
+// New leaf spelling word[pos..] at position slot among node's children
+uint32_t Autocomplete::add_child(uint32_t node, uint32_t slot, const std::string& word, size_t pos) {
+    // Siblings must stay contiguous: the block moves to the end with room for one more
+    uint32_t old_first = nodes[node].first_child;
+    uint32_t count = nodes[node].num_children;
+    uint32_t first = static_cast<uint32_t>(nodes.size());
+    nodes.resize(first + count + 1);
+    parents.resize(nodes.size(), node);
+    top_offset.resize(nodes.size(), 0);
+    for (uint32_t i = 0; i < count; ++i) move_node(old_first + i, first + i + (i >= slot ? 1 : 0));
+    dead_nodes += count;
+
+    uint32_t leaf = first + slot;
+    nodes[leaf] = TrieNode{static_cast<uint32_t>(labels.size()), 0, NOT_A_WORD,
+                           static_cast<uint16_t>(word.size() - pos), 0};
+    labels.append(word, pos, std::string::npos);
+    parents[leaf] = node;
+    nodes[node].first_child = first;
+    nodes[node].num_children = static_cast<uint16_t>(count + 1);
+    return leaf;
+}
+
+// Cut node's label after `at` bytes: node keeps its slot with the head of the
+// label, and its old contents move to a single child holding the tail
+void Autocomplete::split_node(uint32_t node, size_t at) {
+    TrieNode head = nodes[node];
+    uint32_t tail = static_cast<uint32_t>(nodes.size());
+    nodes.resize(tail + 1);
+    parents.resize(tail + 1);
+    top_offset.resize(tail + 1, 0);
+    move_node(node, tail);
+    parents[tail] = node;
+    nodes[tail].label_offset += static_cast<uint32_t>(at);
+    nodes[tail].label_length -= static_cast<uint16_t>(at);
+    nodes[node] = TrieNode{head.label_offset, tail, NOT_A_WORD, static_cast<uint16_t>(at), 1};
+}
+
+// Lists are fixed bottom-up, so each ancestor can merge its children's lists
+void Autocomplete::rerank_path(uint32_t word) {
+    for (uint32_t node = word_nodes[word];; node = parents[node]) {
+        rerank(node, word);
+        if (node == 0) break;
+    }
+}
+
+void Autocomplete::rerank(uint32_t node, uint32_t word) {
+    uint32_t list = top_offset[node];
+    if (list == 0) {
+        refresh_list(node);
+        return;
+    }
+
+    uint32_t& count = top_lists[list];
+    uint32_t* slots = &top_lists[list + 1];
+    uint32_t* it = std::find(slots, slots + count, word);
+    bool listed = it != slots + count;
+    if (!listed) {
+        if (count < TOP_K) {
+            *it = word;
+            ++count;
+        } else if (better_word(word, slots[count - 1])) {
+            it = slots + count - 1;
+            *it = word;
+        } else {
+            return;
+        }
+    }
+    while (it != slots && better_word(*it, *(it - 1))) {
+        std::swap(*it, *(it - 1));
+        --it;
+    }
+
+    // A listed word that ends up last may have lost weight to a word outside the list
+    uint32_t* last = slots + count - 1;
+    if (listed && (it == last || better_word(*(it + 1), *it))) rebuild_list(node);
+}
+
+void Autocomplete::refresh_list(uint32_t node) {
+    if (top_offset[node] == 0) {
+        // Small subtrees are walked at query time until they outgrow TOP_K
+        if (count_words(node, TOP_K + 1) <= TOP_K) return;
+        top_offset[node] = static_cast<uint32_t>(top_lists.size());
+        top_lists.resize(top_lists.size() + 1 + TOP_K, 0);
+    }
+    rebuild_list(node);
+}
+
+// Own word plus each child's list, or all words of children too small for one.
+// Candidates are gathered in word order (own word, then children by byte, each
+// list or walk in order), so a stable sort on df alone reproduces the ranking.
+void Autocomplete::rebuild_list(uint32_t node) {
+    std::vector<uint32_t> words;
+    const TrieNode& n = nodes[node];
+    if (n.word != NOT_A_WORD) words.push_back(static_cast<uint32_t>(n.word));
+    for (uint32_t c = n.first_child; c < n.first_child + n.num_children; ++c) {
+        uint32_t child_list = top_offset[c];
+        if (child_list != 0) {
+            const uint32_t* slots = &top_lists[child_list + 1];
+            words.insert(words.end(), slots, slots + top_lists[child_list]);
+        } else {
+            collect_words(c, words);
         }
-        node->is_word = true;
-        node->word = lower_token;
     }
+
+    std::vector<std::pair<int, uint32_t>> candidates; // (df, word)
+    candidates.reserve(words.size());
+    for (uint32_t word : words) candidates.emplace_back(word_df(word), word);
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    size_t keep = std::min(candidates.size(), TOP_K);
+    uint32_t list = top_offset[node];
+    top_lists[list] = static_cast<uint32_t>(keep);
+    for (size_t i = 0; i < keep; ++i) top_lists[list + 1 + i] = candidates[i].second;
+}
+
+size_t Autocomplete::count_words(uint32_t node, size_t limit) const {
+    const TrieNode& n = nodes[node];
+    size_t count = n.word != NOT_A_WORD ? 1 : 0;
+    for (uint32_t c = n.first_child; c < n.first_child + n.num_children && count < limit; ++c) {
+        count += count_words(c, limit - count);
+    }
+    return count;
+}
+
+void Autocomplete::collect_words(uint32_t node, std::vector<uint32_t>& out) const {
+    const TrieNode& n = nodes[node];
+    if (n.word != NOT_A_WORD) out.push_back(static_cast<uint32_t>(n.word));
+    for (uint32_t c = n.first_child; c < n.first_child + n.num_children; ++c) collect_words(c, out);
 }
 
-void Autocomplete::dfs(std::shared_ptr<TrieNode> node, std::vector<std::pair<std::string, int>>& result) {
-    if (node->is_word) {
-        int term_id = lexicon.get_term_id(node->word);
-        int df = term_id >= 0 ? lexicon.get_df(term_id) : 0;
-        result.push_back({node->word, df});
+// Drop the slots abandoned by inserts by bulk-loading the current words
+void Autocomplete::compact() {
+    std::vector<std::string> words;
+    words.reserve(word_nodes.size());
+    for (uint32_t node : word_nodes) words.push_back(word_at(node));
+    bulk_load(words);
+}
+
+void Autocomplete::dfs(uint32_t node, std::string& word, std::vector<std::pair<std::string, int>>& result) const {
+    const TrieNode& n = nodes[node];
+    if (n.word != NOT_A_WORD) result.push_back({word, word_df(static_cast<uint32_t>(n.word))});
+    for (uint32_t c = n.first_child; c < n.first_child + n.num_children; ++c) {
+        const TrieNode& child = nodes[c];
+        word.append(labels, child.label_offset, child.label_length);
+        dfs(c, word, result);
+        word.resize(word.size() - child.label_length);
     }
-    for (auto& p : node->children) { // classic iteration
-        dfs(p.second, result);
+}
+
+uint32_t Autocomplete::descend(const std::string& prefix, std::string& word) const {
+    // Walk down the compressed edges; the prefix may end inside a label
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < prefix.size()) {
+        const TrieNode& n = nodes[node];
+        const TrieNode* begin = nodes.data() + n.first_child;
+        const TrieNode* end = begin + n.num_children;
+        unsigned char c = static_cast<unsigned char>(prefix[pos]);
+        const TrieNode* child = std::lower_bound(begin, end, c, [this](const TrieNode& t, unsigned char ch) {
+            return static_cast<unsigned char>(labels[t.label_offset]) < ch;
+        });
+        if (child == end || static_cast<unsigned char>(labels[child->label_offset]) != c) return NO_NODE;
+
+        size_t matched = std::min<size_t>(child->label_length, prefix.size() - pos);
+        if (labels.compare(child->label_offset, matched, prefix, pos, matched) != 0) return NO_NODE;
+        word.append(labels, child->label_offset, child->label_length);
+        pos += matched;
+        node = static_cast<uint32_t>(child - nodes.data());
     }
+    return node;
 }
 
 std::vector<std::string> Autocomplete::get_suggestions(const std::string& prefix, int max_suggestions) {
-    auto node = root;
+    if (nodes.empty()) return {};
     std::string pre = to_lower(prefix);
 
-    for (char c : pre) {
-        if (!node->children.count(c)) return {};
-        node = node->children[c];
+    std::string word; // spelled by the path to `node`
+    uint32_t node = descend(pre, word);
+    if (node == NO_NODE) return {};
+
+    std::vector<std::string> suggestions;
+    if (max_suggestions <= 0) return suggestions;
+
+    // Large subtree: precomputed list, O(k) words rebuilt from their nodes
+    uint32_t list = top_offset[node];
+    if (list != 0 && static_cast<size_t>(max_suggestions) <= TOP_K) {
+        size_t count = std::min<size_t>(top_lists[list], static_cast<size_t>(max_suggestions));
+        for (size_t i = 0; i < count; ++i) suggestions.push_back(word_at(word_nodes[top_lists[list + 1 + i]]));
+        return suggestions;
     }
 
+    // Small subtree (at most TOP_K words), or more suggestions than were precomputed
     std::vector<std::pair<std::string, int>> words;
-    dfs(node, words);
+    dfs(node, word, words);
 
-    // Sort by DF descending
+    // Sort by DF descending, then alphabetically
     std::sort(words.begin(), words.end(), [](const auto& a, const auto& b) {
-        return b.second > a.second;
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
     });
 
-    std::vector<std::string> suggestions;
     for (size_t i = 0; i < words.size() && i < (size_t)max_suggestions; ++i) {
         suggestions.push_back(words[i].first);
     }
     return suggestions;
-}
\ No newline at end of file
+}
+
+// Upper bound on the df of any word below node
+int Autocomplete::best_df(uint32_t node) const {
+    uint32_t list = top_offset[node];
+    if (list != 0) return top_lists[list] > 0 ? word_df(top_lists[list + 1]) : 0;
+    std::vector<uint32_t> words;
+    collect_words(node, words);
+    int best = 0;
+    for (uint32_t word : words) best = std::max(best, word_df(word));
+    return best;
+}
+
+// Every word below node completes the typed prefix with `edits` edits; only
+// the subtree's k best can make the final list, since the rest of it ties or
+// loses on edits and loses on df
+void Autocomplete::add_fuzzy_matches(uint32_t node, int edits, size_t k,
+                                     std::unordered_map<uint32_t, int>& matches) const {
+    std::vector<uint32_t> words;
+    uint32_t list = top_offset[node];
+    if (list != 0 && k <= TOP_K) {
+        words.assign(&top_lists[list + 1], &top_lists[list + 1] + std::min<size_t>(top_lists[list], k));
+    } else {
+        collect_words(node, words);
+    }
+    for (uint32_t word : words) {
+        auto [it, inserted] = matches.emplace(word, edits);
+        if (!inserted) it->second = std::min(it->second, edits);
+    }
+}
+
+std::vector<std::string> Autocomplete::get_fuzzy_suggestions(const std::string& prefix, int max_suggestions,
+                                                             int max_edits, int budget_us, bool* truncated) const {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    if (truncated) *truncated = false;
+    if (nodes.empty() || max_suggestions <= 0) return {};
+
+    std::string pre = to_lower(prefix);
+    int limit = std::max(0, std::min(max_edits, MAX_FUZZY_EDITS));
+    size_t m = pre.size();
+    size_t k = static_cast<size_t>(max_suggestions);
+    auto deadline = start + std::chrono::microseconds(budget_us);
+
+    // rows[state * (m + 1) + i] = edits between pre[0, i) and the string spelled down to the state's node
+    struct State {
+        int min_edits; // lower bound on the edits of any match below
+        int best_df;   // upper bound on the df of any match below
+        uint32_t node;
+        uint32_t row;
+    };
+    auto worse = [](const State& a, const State& b) {
+        return a.min_edits != b.min_edits ? a.min_edits > b.min_edits : a.best_df < b.best_df;
+    };
+    std::priority_queue<State, std::vector<State>, decltype(worse)> frontier(worse);
+    std::vector<int> rows(m + 1);
+    for (size_t i = 0; i <= m; ++i) rows[i] = static_cast<int>(i);
+
+    std::unordered_map<uint32_t, int> matches; // word -> fewest edits
+    if (static_cast<int>(m) <= limit) add_fuzzy_matches(0, static_cast<int>(m), k, matches);
+    frontier.push(State{0, best_df(0), 0, 0});
+
+    // k-th best (edits, -df) among the matches, recomputed when they change
+    std::pair<int, int> kth(std::numeric_limits<int>::max(), 0);
+    size_t kth_version = 0, version = 1;
+    std::vector<std::pair<int, int>> keys;
+
+    std::vector<int> row(m + 1), next(m + 1);
+    size_t expanded = 0;
+    while (!frontier.empty()) {
+        State state = frontier.top();
+        frontier.pop();
+
+        if (matches.size() >= k) {
+            if (kth_version != version) {
+                keys.clear();
+                for (const auto& [word, edits] : matches) keys.emplace_back(edits, -word_df(word));
+                std::nth_element(keys.begin(), keys.begin() + (k - 1), keys.end());
+                kth = keys[k - 1];
+                kth_version = version;
+            }
+            // Every remaining subtree is bounded by this one: none can beat the k-th match
+            if (kth < std::make_pair(state.min_edits, -state.best_df)) break;
+        }
+        if ((++expanded & 15) == 0 && Clock::now() > deadline) {
+            if (truncated) *truncated = true;
+            break;
+        }
+
+        const TrieNode& n = nodes[state.node];
+        for (uint32_t c = n.first_child; c < n.first_child + n.num_children; ++c) {
+            std::copy(rows.begin() + state.row * (m + 1), rows.begin() + (state.row + 1) * (m + 1), row.begin());
+            int row_min = 0;
+            int matched = limit + 1; // fewest edits this child's subtree was added with
+            const TrieNode& child = nodes[c];
+            for (uint16_t b = 0; b < child.label_length; ++b) {
+                char ch = labels[child.label_offset + b];
+                next[0] = row[0] + 1;
+                row_min = next[0];
+                for (size_t i = 1; i <= m; ++i) {
+                    int substitute = row[i - 1] + (pre[i - 1] != ch ? 1 : 0);
+                    next[i] = std::min({row[i] + 1, next[i - 1] + 1, substitute});
+                    row_min = std::min(row_min, next[i]);
+                }
+                row.swap(next);
+                // The whole prefix is matched, so the subtree completes it; deeper
+                // positions may match with fewer edits, down to row_min
+                if (row[m] < matched) {
+                    matched = row[m];
+                    add_fuzzy_matches(c, matched, k, matches);
+                    ++version;
+                }
+                if (row_min > limit || matched == row_min) break;
+            }
+            if (row_min > limit || matched == row_min || child.num_children == 0) continue;
+
+            uint32_t index = static_cast<uint32_t>(rows.size() / (m + 1));
+            rows.insert(rows.end(), row.begin(), row.end());
+            frontier.push(State{row_min, best_df(c), c, index});
+        }
+    }
+
+    std::vector<std::tuple<int, int, std::string>> ranked; // (edits, -df, word)
+    ranked.reserve(matches.size());
+    for (const auto& [word, edits] : matches) ranked.emplace_back(edits, -word_df(word), word_at(word_nodes[word]));
+    size_t keep = std::min(ranked.size(), k);
+    std::partial_sort(ranked.begin(), ranked.begin() + keep, ranked.end());
+
+    std::vector<std::string> suggestions;
+    for (size_t i = 0; i < keep; ++i) suggestions.push_back(std::get<2>(ranked[i]));
+    return suggestions;
+}
@@ -0,0 +1,132 @@
+#include "term_expansion.h"
+#include "thread_pool.h"
+#include "vector_kernels.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <utility>
+
+static const char EXPANSION_MAGIC[4] = {'T', 'E', 'X', 'P'};
+static const uint32_t EXPANSION_VERSION = 1;
+
+// Block sizes for the all-pairs product: one block of candidate rows
+// (ROW_BLOCK x stride floats, 256 KB at stride 64) is scored against a whole
+// block of query rows while it is still in cache
+static const size_t QUERY_BLOCK = 64;
+static const size_t ROW_BLOCK = 1024;
+
+bool TermExpansionTable::build(const float* rows, const std::vector<int>& row_terms, size_t stride, size_t num_terms,
+                               int k, size_t num_threads, uint64_t fingerprint, const std::string& path) {
+    if (k <= 0) return false;
+    size_t n = row_terms.size();
+    size_t slots = static_cast<size_t>(k);
+    std::vector<ExpansionEntry> table(num_terms * slots, ExpansionEntry{-1, 0.0f});
+
+    using Candidate = std::pair<float, int>; // (similarity, row); min-heap keeps the best k
+    size_t num_blocks = (n + QUERY_BLOCK - 1) / QUERY_BLOCK;
+    ThreadPool pool(num_threads);
+    pool.parallel_for(num_blocks, [&](size_t block_begin, size_t block_end) {
+        std::vector<float> scores(QUERY_BLOCK * ROW_BLOCK);
+        std::vector<std::vector<Candidate>> heaps(QUERY_BLOCK);
+        for (size_t block = block_begin; block < block_end; ++block) {
+            size_t q_begin = block * QUERY_BLOCK;
+            size_t q_count = std::min(QUERY_BLOCK, n - q_begin);
+            for (auto& heap : heaps) heap.clear();
+
+            for (size_t r_begin = 0; r_begin < n; r_begin += ROW_BLOCK) {
+                size_t r_count = std::min(ROW_BLOCK, n - r_begin);
+                const float* candidates = rows + r_begin * stride;
+                for (size_t q = 0; q < q_count; ++q) {
+                    dot_product_batch(rows + (q_begin + q) * stride, candidates, stride, r_count, stride,
+                                      &scores[q * ROW_BLOCK]);
+                }
+                for (size_t q = 0; q < q_count; ++q) {
+                    auto& heap = heaps[q];
+                    const float* row_scores = &scores[q * ROW_BLOCK];
+                    for (size_t r = 0; r < r_count; ++r) {
+                        size_t row = r_begin + r;
+                        float sim = row_scores[r];
+                        if (row == q_begin + q || sim <= 0.0f) continue;
+                        if (heap.size() < slots) {
+                            heap.emplace_back(sim, static_cast<int>(row));
+                            std::push_heap(heap.begin(), heap.end(), std::greater<Candidate>());
+                        } else if (sim > heap.front().first) {
+                            std::pop_heap(heap.begin(), heap.end(), std::greater<Candidate>());
+                            heap.back() = Candidate(sim, static_cast<int>(row));
+                            std::push_heap(heap.begin(), heap.end(), std::greater<Candidate>());
+                        }
+                    }
+                }
+            }
+
+            // Each term's slots are written by exactly one block
+            for (size_t q = 0; q < q_count; ++q) {
+                auto& heap = heaps[q];
+                std::sort(heap.begin(), heap.end(), std::greater<Candidate>());
+                ExpansionEntry* out = &table[static_cast<size_t>(row_terms[q_begin + q]) * slots];
+                for (size_t i = 0; i < heap.size(); ++i) {
+                    out[i] = ExpansionEntry{row_terms[heap[i].second], heap[i].first};
+                }
+            }
+        }
+    }, 2);
+
+    TermExpansionHeader hdr = {};
+    std::memcpy(hdr.magic, EXPANSION_MAGIC, sizeof(hdr.magic));
+    hdr.version = EXPANSION_VERSION;
+    hdr.k = static_cast<uint32_t>(k);
+    hdr.num_terms = num_terms;
+    hdr.fingerprint = fingerprint;
+    hdr.entries_offset = sizeof(TermExpansionHeader);
+
+    std::string tmp_file = path + ".tmp";
+    std::ofstream out(tmp_file, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(ExpansionEntry));
+    out.close();
+    if (!out) {
+        std::remove(tmp_file.c_str());
+        return false;
+    }
+
+    // Replace any older table (rename cannot overwrite on Windows)
+    std::remove(path.c_str());
+    if (std::rename(tmp_file.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TermExpansionTable::open(const std::string& path, uint64_t fingerprint) {
+    header = nullptr;
+    if (!map.open(path) || map.size() < sizeof(TermExpansionHeader)) {
+        map.close();
+        return false;
+    }
+
+    const auto* hdr = reinterpret_cast<const TermExpansionHeader*>(map.data());
+    bool valid = std::memcmp(hdr->magic, EXPANSION_MAGIC, sizeof(hdr->magic)) == 0 &&
+                 hdr->version == EXPANSION_VERSION &&
+                 hdr->k > 0 &&
+                 hdr->fingerprint == fingerprint &&
+                 hdr->entries_offset % alignof(ExpansionEntry) == 0 &&
+                 hdr->entries_offset + hdr->num_terms * hdr->k * sizeof(ExpansionEntry) <= map.size();
+    if (!valid) {
+        map.close();
+        return false;
+    }
+
+    header = hdr;
+    entries = reinterpret_cast<const ExpansionEntry*>(map.data() + hdr->entries_offset);
+    map.advise(MappedFile::Access::Random);
+    return true;
+}
+
+const ExpansionEntry* TermExpansionTable::neighbors(int term_id) const {
+    if (!header || term_id < 0 || static_cast<uint64_t>(term_id) >= header->num_terms) return nullptr;
+    return entries + static_cast<size_t>(term_id) * header->k;
+}
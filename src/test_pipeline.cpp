@@ -0,0 +1,198 @@
+// Regression checks for the Stage 8 autocomplete trie.
+// Standalone (not part of the search_engine build):
+//   g++ -std=c++17 -I./include src/test_pipeline.cpp src/stage1_lexicon.cpp src/stage8_autocomplete.cpp -o test_pipeline.exe -O2
+// Exits non-zero if any check fails.
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+#include "stage1_lexicon.h"
+#include "stage8_autocomplete.h"
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (!ok) {
+        ++failures;
+        std::cerr << "[FAIL] " << what << std::endl;
+    }
+}
+
+static std::string join(const std::vector<std::string>& words) {
+    std::string out;
+    for (const auto& w : words) out += (out.empty() ? "" : " ") + w;
+    return out;
+}
+
+// Simulates DynamicIndexer::add_document: new terms enter the lexicon, every unique term's DF
+// is incremented, then the trie is refreshed with the whole batch
+static void add_document(Lexicon& lex, Autocomplete& trie, const std::vector<std::string>& tokens) {
+    std::unordered_set<int> unique_terms;
+    for (const auto& token : tokens) {
+        int term_id = lex.add_or_get_term_id(token);
+        if (term_id >= 0) unique_terms.insert(term_id);
+    }
+    std::vector<std::string> changed;
+    for (int term_id : unique_terms) {
+        lex.increment_df(term_id);
+        changed.push_back(lex.get_term_string(term_id));
+    }
+    trie.refresh_terms(changed);
+}
+
+// Every prefix of every word (plus the empty prefix) must complete exactly as a trie bulk-loaded
+// from the same lexicon does
+static void compare_with_rebuild(const Lexicon& lex, Autocomplete& trie, const std::string& label) {
+    std::vector<std::string> docs;
+    Autocomplete fresh(docs, lex);
+    fresh.rebuild_from_lexicon();
+    check(trie.num_words() == fresh.num_words(), label + ": word count");
+
+    std::unordered_set<std::string> prefixes{""};
+    for (const auto& [token, term_id] : lex.get_token_to_id()) {
+        for (size_t len = 1; len <= token.size(); ++len) prefixes.insert(token.substr(0, len));
+    }
+    for (const auto& prefix : prefixes) {
+        for (int k : {1, 5, 10, 11, 50}) {
+            auto got = trie.get_suggestions(prefix, k);
+            auto want = fresh.get_suggestions(prefix, k);
+            check(got == want, label + ": AUTO \"" + prefix + "\" k=" + std::to_string(k) + " got [" + join(got) +
+                                   "] want [" + join(want) + "]");
+        }
+    }
+}
+
+// Batches whose inserts relocate nodes on an earlier word's path (sibling block growth, edge split)
+static void test_batch_relocation() {
+    std::vector<std::string> docs;
+    std::string doc;
+    for (int i = 1; i <= 20; ++i) doc += "ba" + std::to_string(i) + " bb" + std::to_string(i) + " ";
+    docs.push_back(doc);
+    Lexicon lex;
+    lex.build_from_docs(docs);
+    Autocomplete trie(docs, lex);
+    trie.rebuild_from_lexicon();
+
+    // "ba99" gets the highest DF; inserting "bc1" afterwards moves the "b" children block
+    int ba99 = lex.add_or_get_term_id("ba99");
+    for (int i = 0; i < 100; ++i) lex.increment_df(ba99);
+    lex.increment_df(lex.add_or_get_term_id("bc1"));
+    trie.refresh_terms({"ba99", "bc1"});
+
+    auto top = trie.get_suggestions("b", 1);
+    check(!top.empty() && top[0] == "ba99", "relocation: AUTO \"b\" starts with ba99, got [" + join(top) + "]");
+    compare_with_rebuild(lex, trie, "relocation");
+
+    // Same words one by one, and a word that splits an existing edge ("ba" -> "bax" / "ba1")
+    lex.increment_df(lex.add_or_get_term_id("baxy"));
+    trie.insert_term("baxy");
+    int ba5 = lex.get_term_id("ba5");
+    for (int i = 0; i < 200; ++i) lex.increment_df(ba5);
+    check(trie.update_weight("ba5"), "relocation: update_weight finds ba5");
+    compare_with_rebuild(lex, trie, "single inserts");
+}
+
+// Random ingestion: many small batches over a growing vocabulary, checked against a rebuild
+static void test_random_ingestion() {
+    std::mt19937 rng(11);
+    auto random_word = [&rng]() {
+        std::string w;
+        int len = 2 + static_cast<int>(rng() % 6);
+        for (int i = 0; i < len; ++i) w += static_cast<char>('a' + rng() % 5);
+        return w;
+    };
+    std::vector<std::string> docs;
+    for (int d = 0; d < 50; ++d) {
+        std::string doc;
+        for (int i = 0; i < 10; ++i) doc += random_word() + " ";
+        docs.push_back(doc);
+    }
+    Lexicon lex;
+    lex.build_from_docs(docs);
+    Autocomplete trie(docs, lex);
+    trie.rebuild_from_lexicon();
+
+    for (int d = 0; d < 400; ++d) {
+        std::vector<std::string> tokens;
+        for (int i = 0; i < 8; ++i) tokens.push_back(random_word());
+        add_document(lex, trie, tokens);
+        if (d % 100 == 99) compare_with_rebuild(lex, trie, "random ingestion after " + std::to_string(d + 1) + " docs");
+    }
+}
+
+// Smallest edit distance between prefix and any prefix of word
+static int prefix_distance(const std::string& prefix, const std::string& word) {
+    std::vector<int> row(prefix.size() + 1), next(prefix.size() + 1);
+    for (size_t i = 0; i <= prefix.size(); ++i) row[i] = static_cast<int>(i);
+    int best = row[prefix.size()];
+    for (char ch : word) {
+        next[0] = row[0] + 1;
+        for (size_t i = 1; i <= prefix.size(); ++i) {
+            next[i] = std::min({row[i] + 1, next[i - 1] + 1, row[i - 1] + (prefix[i - 1] != ch ? 1 : 0)});
+        }
+        row.swap(next);
+        best = std::min(best, row[prefix.size()]);
+    }
+    return best;
+}
+
+// Fuzzy completions against a brute-force scan of the whole lexicon
+static void test_fuzzy() {
+    std::mt19937 rng(5);
+    std::vector<std::string> docs;
+    for (int d = 0; d < 300; ++d) {
+        std::string doc;
+        for (int i = 0; i < 10; ++i) {
+            int len = 2 + static_cast<int>(rng() % 6);
+            for (int j = 0; j < len; ++j) doc += static_cast<char>('a' + rng() % 6);
+            doc += " ";
+        }
+        docs.push_back(doc);
+    }
+    Lexicon lex;
+    lex.build_from_docs(docs);
+    Autocomplete trie(docs, lex);
+    trie.rebuild_from_lexicon();
+
+    std::vector<std::string> prefixes{"", "a", "zz", "abcdef"};
+    for (const auto& [token, term_id] : lex.get_token_to_id()) {
+        if (rng() % 20 != 0) continue;
+        std::string prefix = token.substr(0, 1 + rng() % token.size());
+        if (prefix.size() > 1 && rng() % 2) prefix[rng() % prefix.size()] = static_cast<char>('a' + rng() % 6);
+        prefixes.push_back(prefix);
+    }
+    for (const auto& prefix : prefixes) {
+        for (int edits = 0; edits <= Autocomplete::MAX_FUZZY_EDITS; ++edits) {
+            for (int k : {1, 5, 20}) {
+                std::vector<std::tuple<int, int, std::string>> ranked; // (edits, -df, word)
+                for (const auto& [token, term_id] : lex.get_token_to_id()) {
+                    int d = prefix_distance(prefix, token);
+                    if (d <= edits) ranked.emplace_back(d, -lex.get_df(term_id), token);
+                }
+                std::sort(ranked.begin(), ranked.end());
+                std::vector<std::string> want;
+                for (size_t i = 0; i < ranked.size() && i < static_cast<size_t>(k); ++i) want.push_back(std::get<2>(ranked[i]));
+
+                // Budget large enough that the walk is never cut short
+                auto got = trie.get_fuzzy_suggestions(prefix, k, edits, 10000000);
+                check(got == want, "FUZZY \"" + prefix + "\" edits=" + std::to_string(edits) + " k=" +
+                                       std::to_string(k) + " got [" + join(got) + "] want [" + join(want) + "]");
+            }
+        }
+    }
+}
+
+int main() {
+    test_batch_relocation();
+    test_random_ingestion();
+    test_fuzzy();
+    if (failures > 0) {
+        std::cerr << "[TEST] " << failures << " check(s) failed." << std::endl;
+        return 1;
+    }
+    std::cout << "[TEST] All autocomplete checks passed." << std::endl;
+    return 0;
+}
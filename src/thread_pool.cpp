@@ -0,0 +1,52 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    if (num_threads == 0) num_threads = 1;
+    workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+size_t ThreadPool::default_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+void ThreadPool::parallel_for(size_t n, const std::function<void(size_t, size_t)>& fn, size_t min_parallel) {
+    if (workers.size() <= 1 || n < min_parallel) {
+        fn(0, n);
+        return;
+    }
+    size_t chunk = (n + workers.size() - 1) / workers.size();
+    std::vector<std::future<void>> done;
+    for (size_t begin = 0; begin < n; begin += chunk) {
+        size_t end = std::min(n, begin + chunk);
+        done.push_back(submit([&fn, begin, end]() { fn(begin, end); }));
+    }
+    for (auto& f : done) f.get();
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) return; // stopping and drained
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        task();
+    }
+}
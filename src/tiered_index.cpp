@@ -0,0 +1,153 @@
+#include "tiered_index.h"
+#include <algorithm>
+
+TieredPostingsStore::TieredPostingsStore(std::shared_ptr<BarrelsReader> cold, size_t ram_budget_bytes)
+    : cold_tier(std::move(cold)), budget_bytes(ram_budget_bytes)
+{
+    stats.budget_bytes = budget_bytes;
+}
+
+// Payload + hash node + shared_ptr control block
+size_t TieredPostingsStore::postings_bytes(size_t count) {
+    return count * sizeof(int) + 96;
+}
+
+void TieredPostingsStore::warm_from_df(const Lexicon& lex) {
+    std::vector<std::pair<int, int>> by_df; // (df, term_id)
+    by_df.reserve(lex.get_token_to_id().size());
+    for (const auto& [token, term_id] : lex.get_token_to_id()) {
+        by_df.push_back({lex.get_df(term_id), term_id});
+    }
+    std::sort(by_df.begin(), by_df.end(), [](const auto& a, const auto& b) {
+        return a.first > b.first;
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& [df, term_id] : by_df) {
+        if (hot_bytes >= budget_bytes) break;
+        promote(term_id); // skips lists that do not fit
+    }
+}
+
+bool TieredPostingsStore::lookup_hot(int term_id, PostingsView& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    access_counts[term_id]++;
+    accesses_since_rebalance++;
+
+    auto it = hot_tier.find(term_id);
+    if (it == hot_tier.end()) {
+        stats.cold_hits++;
+        return false;
+    }
+
+    stats.hot_hits++;
+    out.data = it->second->data();
+    out.size = it->second->size();
+    out.owner = it->second; // survives a concurrent demotion
+    return true;
+}
+
+void TieredPostingsStore::maybe_rebalance() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (accesses_since_rebalance >= REBALANCE_INTERVAL) rebalance();
+}
+
+bool TieredPostingsStore::promote(int term_id) {
+    if (hot_tier.count(term_id)) return true;
+
+    PostingsView view = cold_tier->get_postings_view(term_id);
+    if (view.empty()) return false;
+
+    size_t bytes = postings_bytes(view.size);
+    if (hot_bytes + bytes > budget_bytes) return false;
+
+    hot_tier[term_id] = std::make_shared<const std::vector<int>>(view.begin(), view.end());
+    hot_bytes += bytes;
+    stats.promotions++;
+    return true;
+}
+
+void TieredPostingsStore::demote(int term_id) {
+    auto it = hot_tier.find(term_id);
+    if (it == hot_tier.end()) return;
+    hot_bytes -= postings_bytes(it->second->size());
+    hot_tier.erase(it);
+    stats.demotions++;
+}
+
+void TieredPostingsStore::rebalance() {
+    auto count_of = [this](int term_id) {
+        auto it = access_counts.find(term_id);
+        return it != access_counts.end() ? it->second : 0u;
+    };
+
+    // Cold candidates, hottest first
+    std::vector<std::pair<uint32_t, int>> candidates;
+    for (const auto& [term_id, count] : access_counts) {
+        if (!hot_tier.count(term_id)) candidates.push_back({count, term_id});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a.first > b.first;
+    });
+
+    // Residents, coldest first
+    std::vector<std::pair<uint32_t, int>> residents;
+    residents.reserve(hot_tier.size());
+    for (const auto& [term_id, postings] : hot_tier) {
+        residents.push_back({count_of(term_id), term_id});
+    }
+    std::sort(residents.begin(), residents.end());
+
+    size_t next_victim = 0;
+    for (const auto& [count, term_id] : candidates) {
+        PostingsView view = cold_tier->get_postings_view(term_id);
+        if (view.empty()) continue;
+        size_t bytes = postings_bytes(view.size);
+        if (bytes > budget_bytes) continue;
+
+        // Demote strictly colder residents until the candidate fits
+        while (hot_bytes + bytes > budget_bytes && next_victim < residents.size() &&
+               residents[next_victim].first < count) {
+            demote(residents[next_victim].second);
+            ++next_victim;
+        }
+        if (hot_bytes + bytes > budget_bytes) break; // no colder residents left
+        promote(term_id);
+    }
+
+    // Age counts so the split tracks recent traffic
+    for (auto it = access_counts.begin(); it != access_counts.end();) {
+        it->second >>= 1;
+        if (it->second == 0) it = access_counts.erase(it);
+        else ++it;
+    }
+    accesses_since_rebalance = 0;
+}
+
+void TieredPostingsStore::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget_bytes = bytes;
+    stats.budget_bytes = bytes;
+
+    // Shrink: drop the least-accessed residents first
+    if (hot_bytes > budget_bytes) {
+        std::vector<std::pair<uint32_t, int>> residents;
+        for (const auto& [term_id, postings] : hot_tier) {
+            auto it = access_counts.find(term_id);
+            residents.push_back({it != access_counts.end() ? it->second : 0u, term_id});
+        }
+        std::sort(residents.begin(), residents.end());
+        for (const auto& [count, term_id] : residents) {
+            if (hot_bytes <= budget_bytes) break;
+            demote(term_id);
+        }
+    }
+}
+
+TieredStats TieredPostingsStore::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    TieredStats s = stats;
+    s.hot_terms = hot_tier.size();
+    s.hot_bytes = hot_bytes;
+    return s;
+}
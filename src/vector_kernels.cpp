@@ -0,0 +1,338 @@
+#include "vector_kernels.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define VECTOR_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define KERNEL_TARGET(isa)
+#else
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+using DotFn = float (*)(const float*, const float*, size_t);
+using DotF16Fn = float (*)(const float*, const uint16_t*, size_t);
+using DotI8Fn = float (*)(const float*, const int8_t*, size_t);
+
+uint16_t float_to_half(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t exp = (x >> 23) & 0xFF;
+    uint32_t mant = x & 0x7FFFFF;
+
+    if (exp == 0xFF) return static_cast<uint16_t>(sign | 0x7C00 | (mant ? 0x200 : 0)); // inf / nan
+    int e = static_cast<int>(exp) - 127 + 15;
+    if (e >= 0x1F) return static_cast<uint16_t>(sign | 0x7C00); // overflow to inf
+    if (e <= 0) {
+        // Subnormal half (or zero)
+        if (e < -10) return static_cast<uint16_t>(sign);
+        mant |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - e);
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half & 1))) ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = sign | (static_cast<uint32_t>(e) << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1FFF;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) ++half; // a carry correctly rounds up the exponent
+    return static_cast<uint16_t>(half);
+}
+
+float half_to_float(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F;
+    uint32_t mant = h & 0x3FF;
+    uint32_t bits;
+    if (exp == 0) {
+        if (mant == 0) {
+            bits = sign;
+        } else {
+            // Subnormal half: normalize into a float exponent
+            exp = 127 - 15 + 1;
+            while (!(mant & 0x400)) {
+                mant <<= 1;
+                --exp;
+            }
+            bits = sign | (exp << 23) | ((mant & 0x3FF) << 13);
+        }
+    } else if (exp == 0x1F) {
+        bits = sign | 0x7F800000 | (mant << 13);
+    } else {
+        bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static float dot_scalar(const float* a, const float* b, size_t n) {
+    // Four independent partial sums so the compiler can pipeline the adds
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static float dot_f16_scalar(const float* q, const uint16_t* v, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) sum += q[i] * half_to_float(v[i]);
+    return sum;
+}
+
+static float dot_i8_scalar(const float* q, const int8_t* v, size_t n) {
+    float s0 = 0.0f, s1 = 0.0f;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        s0 += q[i] * v[i];
+        s1 += q[i + 1] * v[i + 1];
+    }
+    for (; i < n; ++i) s0 += q[i] * v[i];
+    return s0 + s1;
+}
+
+#ifdef VECTOR_KERNELS_X86
+
+KERNEL_TARGET("avx")
+static inline float hsum256(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+
+KERNEL_TARGET("avx2,fma")
+static float dot_avx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    if (i + 8 <= n) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        i += 8;
+    }
+    float result = hsum256(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) result += a[i] * b[i];
+    return result;
+}
+
+// Also needs F16C: selected only when the CPU reports it (a VM may hide it even with AVX2)
+KERNEL_TARGET("avx2,fma,f16c")
+static float dot_f16_avx2(const float* q, const uint16_t* v, size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)));
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), d, acc);
+    }
+    float result = hsum256(acc);
+    for (; i < n; ++i) result += q[i] * half_to_float(v[i]);
+    return result;
+}
+
+KERNEL_TARGET("avx2,fma")
+static float dot_i8_avx2(const float* q, const int8_t* v, size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + i));
+        __m256 d = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), d, acc);
+    }
+    float result = hsum256(acc);
+    for (; i < n; ++i) result += q[i] * v[i];
+    return result;
+}
+
+// GCC 12's AVX-512 headers seed intrinsics with _mm512_undefined_*(), which
+// trips -W(maybe-)uninitialized inside the headers themselves (GCC PR 105593)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// Reduce through memory rather than the 512->256 extract intrinsics
+KERNEL_TARGET("avx512f")
+static inline float reduce512(__m512 acc) {
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, acc);
+    return hsum256(_mm256_add_ps(_mm256_load_ps(lanes), _mm256_load_ps(lanes + 8)));
+}
+
+KERNEL_TARGET("avx512f")
+static float dot_avx512(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < n) {
+        // Masked load for the tail: lanes past n read as zero
+        __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return reduce512(_mm512_add_ps(acc0, acc1));
+}
+
+KERNEL_TARGET("avx512f")
+static float dot_f16_avx512(const float* q, const uint16_t* v, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(q + i), d, acc);
+    }
+    float result = reduce512(acc);
+    for (; i < n; ++i) result += q[i] * half_to_float(v[i]);
+    return result;
+}
+
+KERNEL_TARGET("avx512f")
+static float dot_i8_avx512(const float* q, const int8_t* v, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        __m512 d = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(bytes));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(q + i), d, acc);
+    }
+    float result = reduce512(acc);
+    for (; i < n; ++i) result += q[i] * v[i];
+    return result;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+enum class CpuLevel { Scalar, Avx2, Avx512 };
+
+static CpuLevel detect_cpu() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return CpuLevel::Scalar;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave) return CpuLevel::Scalar;
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+    // The OS must save YMM (bits 1-2) and, for AVX-512, opmask/ZMM state (bits 5-7)
+    if (avx512f && (xcr0 & 0xE6) == 0xE6) return CpuLevel::Avx512;
+    if (avx2 && fma && (xcr0 & 0x6) == 0x6) return CpuLevel::Avx2;
+    return CpuLevel::Scalar;
+#else
+    // libgcc also checks XCR0, so these imply OS support
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return CpuLevel::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return CpuLevel::Avx2;
+    return CpuLevel::Scalar;
+#endif
+}
+
+// F16C (vcvtph2ps on YMM) for the AVX2 fp16 kernel; the AVX-512 one converts with AVX-512F itself
+static bool cpu_has_f16c() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 29)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("f16c");
+#endif
+}
+
+#endif // VECTOR_KERNELS_X86
+
+struct KernelChoice {
+    DotFn dot;
+    DotF16Fn dot_f16;
+    DotI8Fn dot_i8;
+    const char* name;
+};
+
+static const KernelChoice& kernel() {
+    static const KernelChoice choice = [] {
+#ifdef VECTOR_KERNELS_X86
+        switch (detect_cpu()) {
+            case CpuLevel::Avx512: return KernelChoice{dot_avx512, dot_f16_avx512, dot_i8_avx512, "avx512"};
+            case CpuLevel::Avx2:
+                return KernelChoice{dot_avx2, cpu_has_f16c() ? dot_f16_avx2 : dot_f16_scalar, dot_i8_avx2, "avx2"};
+            default: break;
+        }
+#endif
+        return KernelChoice{dot_scalar, dot_f16_scalar, dot_i8_scalar, "scalar"};
+    }();
+    return choice;
+}
+
+float dot_product(const float* a, const float* b, size_t n) {
+    return kernel().dot(a, b, n);
+}
+
+float dot_product_f16(const float* q, const uint16_t* v, size_t n) {
+    return kernel().dot_f16(q, v, n);
+}
+
+float dot_product_i8(const float* q, const int8_t* v, size_t n) {
+    return kernel().dot_i8(q, v, n);
+}
+
+void dot_product_batch(const float* q, const float* rows, size_t stride, size_t num_rows, size_t n, float* out) {
+    DotFn dot = kernel().dot;
+    for (size_t r = 0; r < num_rows; ++r) {
+        out[r] = dot(q, rows + r * stride, n);
+    }
+}
+
+float normalize_l2(float* v, size_t n) {
+    float norm = std::sqrt(kernel().dot(v, v, n));
+    if (norm > 0.0f) {
+        float inv = 1.0f / norm;
+        for (size_t i = 0; i < n; ++i) v[i] *= inv;
+    }
+    return norm;
+}
+
+uint64_t matrix_fingerprint(const float* rows, size_t num_rows, size_t stride) {
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void* data, size_t len) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    uint64_t shape[2] = {num_rows, stride};
+    mix(shape, sizeof(shape));
+    // Every row, so a change to any one vector invalidates what was built from them
+    mix(rows, num_rows * stride * sizeof(float));
+    return hash;
+}
+
+const char* vector_kernel_name() {
+    return kernel().name;
+}